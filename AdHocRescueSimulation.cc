@@ -51,51 +51,330 @@
 
 #include "ns3/rng-seed-manager.h"
 
+#include "ns3/yans-wifi-channel.h"
+
+#include "ns3/yans-wifi-phy.h"
+
+#include "ns3/wifi-ppdu.h"
+
+#include "ns3/wifi-net-device.h"
+
+#include "ns3/wifi-utils.h"
+
+#include "ns3/map-scheduler.h"
+
+#include "RescueTraceFormat.h"
+
+#include <algorithm>
+
 #include <chrono>
 
+#include <cctype>
+
+#include <cmath>
+
+#include <cstdio>
+
+#include <cstdlib>
+
+#include <cstring>
+
 #include <fstream>
 
 #include <iostream>
 
+#include <limits>
+
+#include <map>
+
+#include <set>
+
+#include <sstream>
+
+#include <typeindex>
+
+#include <unordered_map>
+
+#include <vector>
+
+#include <cxxabi.h>
+
+#include <sys/wait.h>
+
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 using namespace ns3;
 using namespace dsr;
 
 // Nombre del programa
 NS_LOG_COMPONENT_DEFINE("AdHocRescueSimulation");
 
-// VARIABLES GLOBALES
+// Diagnósticos por paquete. Se compilan sólo si RESCUE_LOG_PAQUETES vale 1,
+// que es el valor por defecto cuando ns-3 se compila con NS_LOG; compilando
+// con -DRESCUE_LOG_PAQUETES=0 desaparecen por completo, incluido el chequeo
+// del nivel de log. En tiempo de ejecución se muestran con --verbosidad=3.
+#ifndef RESCUE_LOG_PAQUETES
+#ifdef NS3_LOG_ENABLE
+#define RESCUE_LOG_PAQUETES 1
+#else
+#define RESCUE_LOG_PAQUETES 0
+#endif
+#endif
+
+#if RESCUE_LOG_PAQUETES
+#define NS_LOG_PAQUETE(msg) NS_LOG_DEBUG(msg)
+#else
+#define NS_LOG_PAQUETE(msg)
+#endif
+
+// PARÁMETROS DEL ESCENARIO
 //
-// Contenedores de nodos
-NodeContainer rescatistas;
-NodeContainer notificadores;
-NodeContainer centrales;
-NodeContainer allNodes;
+// Todo lo que define una corrida. Los mismos nombres sirven como opciones
+// de línea de comandos y como claves del archivo de escenarios
+// (--escenarios). Los nodos, contadores y colectores de la corrida viven
+// en RescueScenario.
+struct ScenarioConfig {
+  void AgregarOpciones(CommandLine & cmd);
+  void CompletarNombres(void);
+  void AgregarSufijo(const std::string & sufijo, const std::set < std::string > & fijados);
+
+  // Nombre de la sección del archivo de escenarios ("" = línea de comandos)
+  std::string nombre = "";
+
+  int numNotificadores = 5;
+  int numRescatistas = 5;
+  int numCentrales = 2;
+
+  std::string routingProtocol = "AODV"; // protocolo de enrutamiento AODV o OLSR o DLSR
+  double simulationTime = 10; // tiempo de simulación en segundos
+
+  // Semilla y número de corrida del generador de ns-3. Con la misma semilla
+  // y corrida, dos ejecuciones (incluso con distinto protocolo) usan los
+  // mismos números aleatorios. Una semilla 0 toma el reloj del sistema.
+  uint32_t seed = 1;
+  uint64_t run = 1;
+
+  // Réplicas por fork: se ejecuta una vez la configuración y el calentamiento
+  // (convergencia del enrutamiento) y luego se bifurcan replicasFork procesos
+  int replicasFork = 0;
+  double warmupTime = 3;
+
+  // Tráfico de los notificadores: tasa de solicitudes por notificador (por
+  // segundo) y tamaño de la carga útil de cada solicitud
+  double tasaSolicitudes = 2.0;
+  uint32_t tamanoCarga = 1000;
 
-// Contenedor de interfaces IPv4 de todos los nodos
-Ipv4InterfaceContainer allInterfaces;
+  // Reintentos de las solicitudes de los notificadores: tiempo de espera del
+  // primer intento (0 = sin reintentos), número máximo de intentos y factor de
+  // crecimiento de la espera
+  double timeoutSolicitud = 0;
+  uint32_t maxIntentos = 3;
+  double backoffReintentos = 2.0;
+
+  // Agregación en los centrales: retardo máximo (s) que un mensaje espera a
+  // otros hacia el mismo destino (0 = un paquete por mensaje) y bytes
+  // máximos del paquete agregado, sin contar las cabeceras IP y UDP
+  double agregacionRetardo = 0;
+  uint32_t agregacionBytes = 2200;
+
+  // Política de reparto de solicitudes entre centrales
+  std::string politicaCentralNombre = "fija";
+
+  // Política de selección del rescatista en el central
+  std::string politicaRescatistaNombre = "aleatorio";
+
+  // Disposición de los nodos: notificadores y rescatistas parten de una
+  // malla (esquina, separación y nodos por fila) y caminan al azar dentro
+  // del cuadrado [-limiteArea, limiteArea]. Con reparto entre centrales,
+  // éstos se ubican en un círculo de radioCentrales metros.
+  double posicionMinX = 0.0;
+  double posicionMinY = 0.0;
+  double separacionX = 10.0;
+  double separacionY = 20.0;
+  uint32_t nodosPorFila = 3;
+  double limiteArea = 100;
+  double radioCentrales = 50;
+
+  // Movilidad de notificadores y rescatistas: "aleatoria" (RandomWalk2d
+  // durante la corrida) o "precalculada" (recorridos generados antes de
+  // la corrida o cargados de movilidadFileName, ver MobilityTrace). El
+  // archivo es una entrada compartida por los escenarios de un lote: si no
+  // existe se genera y se guarda ahí. intervaloMovilidad es cada cuánto se
+  // avisa CourseChange al canal espacial y al selector de rescatistas.
+  std::string movilidad = "aleatoria";
+  std::string movilidadFileName = "";
+  double intervaloMovilidad = 1.0;
+
+  // Canal wifi con índice espacial y su rango de corte (0 = derivado de la
+  // sensibilidad de recepción)
+  bool canalEspacial = false;
+  double rangoCorte = 0;
+
+  // Latencia por tramo del recorrido (EtapaTag) y archivo CSV con sus
+  // histogramas ("" = no se escribe)
+  bool latenciaEtapas = false;
+  std::string latenciaFileName = "";
+
+  // Contabilidad del tráfico de control por protocolo y su archivo CSV
+  // ("" = routing_overhead.csv junto al archivo de indicadores)
+  bool contabilidadOverhead = true;
+  std::string overheadFileName = "";
+
+  // Muestreo periódico de cola MAC, tabla de rutas y vecinos por nodo
+  // (intervalo en s, 0 = desactivado) y rango de vecindad (0 = alcance de
+  // recepción derivado del modelo de pérdidas)
+  double intervaloMuestreo = 0;
+  std::string muestreoFileName = "series-simulation.csv";
+  double rangoVecinos = 0;
+
+  // Perfil de tiempo de reloj de los callbacks y eventos del simulador
+  bool perfilCallbacks = false;
+
+  // Registro de eventos JSON con límite de tasa por tipo ("" = desactivado)
+  std::string eventLogFileName = "";
+  double eventLogTasa = 100;
+  double eventLogRafaga = 1000;
+
+  // Archivo JSON con métricas de rendimiento de la corrida ("" = no se escribe)
+  std::string perfFileName = "";
+
+  std::string CSVfileName = "output-simulation.csv";
+
+  // Formato de la traza de eventos: "csv" (texto) o "bin" (binario por
+  // columnas, ver RescueTraceFormat.h)
+  std::string formatoTraza = "csv";
+  std::string IndicadoresFileName = "indicadores-simulation.csv";
+};
+
+// Inserta el sufijo antes de la extensión del nombre de archivo
+std::string NombreConSufijo(const std::string & fileName, const std::string & sufijo) {
+  std::size_t punto = fileName.find_last_of('.');
+  std::size_t barra = fileName.find_last_of('/');
+  if (punto == std::string::npos || (barra != std::string::npos && punto < barra)) {
+    return fileName + sufijo;
+  }
+  return fileName.substr(0, punto) + sufijo + fileName.substr(punto);
+}
+
+void ScenarioConfig::AgregarOpciones(CommandLine & cmd) {
+  cmd.AddValue("simulationTime", "Duracion de la simulacion (s)", simulationTime);
+  cmd.AddValue("numNotificadores", "No. de notificadores", numNotificadores);
+  cmd.AddValue("numRescatistas", "No. de rescatistas", numRescatistas);
+  cmd.AddValue("numCentrales", "No. de nodos centrales", numCentrales);
+  cmd.AddValue("routingProtocol", "Tipo de protocolo de enrutamiento", routingProtocol);
+  cmd.AddValue("CSVfileName", "Nombre del archivo CSV", CSVfileName);
+  cmd.AddValue("formatoTraza", "Formato de la traza de eventos: csv o bin", formatoTraza);
+  cmd.AddValue("IndicadoresFileName", "Nombre del archivo CSV de indicadores", IndicadoresFileName);
+  cmd.AddValue("seed", "Semilla del generador aleatorio (0 = reloj del sistema)", seed);
+  cmd.AddValue("run", "Número de corrida (subflujo) del generador aleatorio", run);
+  cmd.AddValue("tasaSolicitudes", "Tasa de solicitudes por segundo de cada notificador", tasaSolicitudes);
+  cmd.AddValue("tamanoCarga", "Bytes de carga útil de cada solicitud", tamanoCarga);
+  cmd.AddValue("replicasFork", "No. de réplicas que se bifurcan (fork) tras el calentamiento (0 = desactivado)", replicasFork);
+  cmd.AddValue("warmupTime", "Tiempo de calentamiento compartido por las réplicas fork (s)", warmupTime);
+  cmd.AddValue("posicionMinX", "Coordenada x (m) de la malla inicial de notificadores y rescatistas", posicionMinX);
+  cmd.AddValue("posicionMinY", "Coordenada y (m) de la malla inicial de notificadores y rescatistas", posicionMinY);
+  cmd.AddValue("separacionX", "Separación (m) entre columnas de la malla inicial", separacionX);
+  cmd.AddValue("separacionY", "Separación (m) entre filas de la malla inicial", separacionY);
+  cmd.AddValue("nodosPorFila", "Nodos por fila de la malla inicial", nodosPorFila);
+  cmd.AddValue("limiteArea", "Medio lado (m) del cuadrado en que caminan los nodos", limiteArea);
+  cmd.AddValue("radioCentrales", "Radio (m) del círculo de centrales cuando se reparten solicitudes", radioCentrales);
+  cmd.AddValue("movilidad", "Movilidad de notificadores y rescatistas: aleatoria o precalculada", movilidad);
+  cmd.AddValue("movilidadFileName", "Recorridos precalculados: binario o traza ns-2 (se genera si no existe)", movilidadFileName);
+  cmd.AddValue("intervaloMovilidad", "Intervalo (s) de los avisos CourseChange de la movilidad precalculada", intervaloMovilidad);
+  cmd.AddValue("canalEspacial", "Usar el canal wifi con índice espacial (GridWifiChannel)", canalEspacial);
+  cmd.AddValue("rangoCorte", "Rango de corte (m) del canal espacial (0 = derivado de la sensibilidad)", rangoCorte);
+  cmd.AddValue("politicaCentral", "Reparto de solicitudes entre centrales: fija, hash, cercana o menosCargada", politicaCentralNombre);
+  cmd.AddValue("politicaRescatista", "Selección de rescatista: aleatorio, cercano, menosCargado o menosSaltos", politicaRescatistaNombre);
+  cmd.AddValue("timeoutSolicitud", "Tiempo de espera de la respuesta antes de reintentar (s, 0 = sin reintentos)", timeoutSolicitud);
+  cmd.AddValue("maxIntentos", "Número máximo de intentos por solicitud", maxIntentos);
+  cmd.AddValue("backoffReintentos", "Factor de crecimiento del tiempo de espera entre intentos", backoffReintentos);
+  cmd.AddValue("agregacionRetardo", "Retardo máximo (s) de agregación de mensajes en los centrales (0 = desactivada)", agregacionRetardo);
+  cmd.AddValue("agregacionBytes", "Bytes máximos de un paquete agregado por los centrales", agregacionBytes);
+  cmd.AddValue("latenciaEtapas", "Medir la latencia de cada tramo del recorrido con byte tags", latenciaEtapas);
+  cmd.AddValue("latenciaFileName", "Archivo CSV con los histogramas de latencia por tramo", latenciaFileName);
+  cmd.AddValue("contabilidadOverhead", "Contar el tráfico de control del enrutamiento y su tiempo de aire", contabilidadOverhead);
+  cmd.AddValue("overheadFileName", "Archivo CSV del overhead de enrutamiento (vacío = junto a los indicadores)", overheadFileName);
+  cmd.AddValue("intervaloMuestreo", "Intervalo (s) del muestreo de cola MAC, rutas y vecinos (0 = desactivado)", intervaloMuestreo);
+  cmd.AddValue("muestreoFileName", "Archivo CSV de las series de tiempo", muestreoFileName);
+  cmd.AddValue("rangoVecinos", "Distancia (m) para contar vecinos (0 = alcance de recepción)", rangoVecinos);
+  cmd.AddValue("perfilCallbacks", "Medir el tiempo de reloj de los callbacks y eventos (se imprime al destruir el simulador)", perfilCallbacks);
+  cmd.AddValue("eventLogFileName", "Registro de eventos JSON con límite de tasa (vacío = desactivado)", eventLogFileName);
+  cmd.AddValue("eventLogTasa", "Eventos por segundo simulado y por tipo en el registro de eventos", eventLogTasa);
+  cmd.AddValue("eventLogRafaga", "Ráfaga máxima de eventos por tipo en el registro de eventos", eventLogRafaga);
+  cmd.AddValue("perfFileName", "Archivo JSON con métricas de rendimiento de la corrida", perfFileName);
+}
+
+// Nombres de salida que dependen de otras opciones
+void ScenarioConfig::CompletarNombres(void) {
+  if (overheadFileName.empty()) {
+    std::size_t barra = IndicadoresFileName.find_last_of('/');
+    overheadFileName = (barra == std::string::npos ? "" : IndicadoresFileName.substr(0, barra + 1)) + "routing_overhead.csv";
+  }
+  if (formatoTraza == "bin" && CSVfileName == "output-simulation.csv") {
+    CSVfileName = "output-simulation.bin";
+  }
+}
+
+// Agrega el sufijo a los archivos de salida cuya clave no está en fijados,
+// para que los escenarios de un mismo archivo no se pisen la salida
+void ScenarioConfig::AgregarSufijo(const std::string & sufijo, const std::set < std::string > & fijados) {
+  std::pair < const char * , std::string * > salidas[] = {
+    std::make_pair("CSVfileName", & CSVfileName),
+    std::make_pair("IndicadoresFileName", & IndicadoresFileName),
+    std::make_pair("overheadFileName", & overheadFileName),
+    std::make_pair("latenciaFileName", & latenciaFileName),
+    std::make_pair("muestreoFileName", & muestreoFileName),
+    std::make_pair("eventLogFileName", & eventLogFileName),
+    std::make_pair("perfFileName", & perfFileName)
+  };
+  for (auto & salida: salidas) {
+    if (!salida.second -> empty() && fijados.count(salida.first) == 0) {
+      * salida.second = NombreConSufijo( * salida.second, sufijo);
+    }
+  }
+}
 
-int numNotificadores = 5;
-int numRescatistas = 5;
-int numCentrales = 2;
+// Nivel de log del componente (0 = nada, 1 = advertencias, 2 = info,
+// 3 = diagnósticos por paquete). Es del proceso, no de cada escenario.
+int verbosidad = 2;
 
-// Variables para el CSV
-int numeroIntentosComunicacion = 0;
-int comunicacionesEfectivas = 0;
+// Flujos (streams) fijos para cada fuente de aleatoriedad del escenario
+// (los que dependen del número de nodos usan rangos amplios y separados)
+const int64_t STREAM_SELECCION_RESCATISTA = 0;
+const int64_t STREAM_LLEGADAS = 1000000;
+const int64_t STREAM_MOVILIDAD = 2000000;
+const int64_t STREAM_WIFI = 3000000;
+const int64_t STREAM_ENRUTAMIENTO = 4000000;
 
-std::string routingProtocol = "AODV"; // protocolo de enrutamiento AODV o OLSR o DLSR
-double simulationTime = 10; // tiempo de simulación en segundos
+// TTL con que salen los paquetes IP (Ipv4L3Protocol::DefaultTtl)
+const uint8_t TTL_INICIAL = 64;
 
-std::string CSVfileName = "output-simulation.csv";
+// Sumidero abierto por AbrirTraza: true si la traza del escenario en curso
+// es binaria
+bool trazaBinaria = false;
 
-// Clase y métodos para el header perzonalizado
-class MyHeader: public Header {
+// Header binario de rescate con tamaño fijo de serialización. Lleva las
+// direcciones del notificador y del rescatista como enteros de 32 bits, el
+// identificador de la solicitud y el instante en que se originó, sin
+// cadenas ni memoria dinámica.
+class RescueHeader: public Header {
   public:
 
-    MyHeader();
-  virtual~MyHeader();
+    RescueHeader();
+  virtual~RescueHeader();
 
-  void SetData(std::string data);
-  std::string GetData(void) const;
+  void SetNotificador(Ipv4Address ip);
+  Ipv4Address GetNotificador(void) const;
+  void SetRescatista(Ipv4Address ip);
+  Ipv4Address GetRescatista(void) const;
+  void SetIdSolicitud(uint32_t id);
+  uint32_t GetIdSolicitud(void) const;
+  void SetTiempoOrigen(Time t);
+  Time GetTiempoOrigen(void) const;
 
   static TypeId GetTypeId(void);
   virtual TypeId GetInstanceTypeId(void) const;
@@ -103,366 +382,4606 @@ class MyHeader: public Header {
   virtual void Serialize(Buffer::Iterator start) const;
   virtual uint32_t Deserialize(Buffer::Iterator start);
   virtual uint32_t GetSerializedSize(void) const;
-  private: std::string m_strData;
+
+  // 4 (notificador) + 4 (rescatista) + 4 (id) + 8 (tiempo en ns)
+  static const uint32_t SERIALIZED_SIZE = 20;
+
+  private: uint32_t m_notificador;
+  uint32_t m_rescatista;
+  uint32_t m_idSolicitud;
+  int64_t m_tiempoOrigen;
 };
 
-MyHeader::MyHeader() {
-  // debemos proveer un constructor público por defecto, 
-  // implícito o explícito, pero nunca privado.
-}
-MyHeader::~MyHeader() {}
+RescueHeader::RescueHeader(): m_notificador(0),
+  m_rescatista(0),
+  m_idSolicitud(0),
+  m_tiempoOrigen(0) {}
+RescueHeader::~RescueHeader() {}
 
 TypeId
-MyHeader::GetTypeId(void) {
-  static TypeId tid = TypeId("ns3::MyHeader")
+RescueHeader::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::RescueHeader")
     .SetParent < Header > ()
-    .AddConstructor < MyHeader > ();
+    .AddConstructor < RescueHeader > ();
   return tid;
 }
 TypeId
-MyHeader::GetInstanceTypeId(void) const {
+RescueHeader::GetInstanceTypeId(void) const {
   return GetTypeId();
 }
 
 void
-MyHeader::Print(std::ostream & os) const {
-  // Este método es invocado por los métodos de impresión de paquetes
-  // para imprimir el contenido de mi header.
-  //os << "data=" << m_strData << std::endl;
+RescueHeader::Print(std::ostream & os) const {
+  os << "notificador=" << Ipv4Address(m_notificador) <<
+    " rescatista=" << Ipv4Address(m_rescatista) <<
+    " id=" << m_idSolicitud <<
+    " origen=" << TimeStep(m_tiempoOrigen).As(Time::S);
+}
+uint32_t RescueHeader::GetSerializedSize(void) const {
+  return SERIALIZED_SIZE;
+}
+void RescueHeader::Serialize(Buffer::Iterator start) const {
+  uint64_t tiempo = static_cast < uint64_t > (m_tiempoOrigen);
+  start.WriteHtonU32(m_notificador);
+  start.WriteHtonU32(m_rescatista);
+  start.WriteHtonU32(m_idSolicitud);
+  start.WriteHtonU32(static_cast < uint32_t > (tiempo >> 32));
+  start.WriteHtonU32(static_cast < uint32_t > (tiempo & 0xffffffff));
+}
+
+uint32_t RescueHeader::Deserialize(Buffer::Iterator start) {
+  m_notificador = start.ReadNtohU32();
+  m_rescatista = start.ReadNtohU32();
+  m_idSolicitud = start.ReadNtohU32();
+  uint64_t tiempo = static_cast < uint64_t > (start.ReadNtohU32()) << 32;
+  tiempo |= start.ReadNtohU32();
+  m_tiempoOrigen = static_cast < int64_t > (tiempo);
+  return SERIALIZED_SIZE;
+}
+
+void RescueHeader::SetNotificador(Ipv4Address ip) {
+  m_notificador = ip.Get();
+}
 
-  os << "data=" << m_strData;
+Ipv4Address RescueHeader::GetNotificador(void) const {
+  return Ipv4Address(m_notificador);
 }
-uint32_t MyHeader::GetSerializedSize(void) const {
-  // Calcula el tamaño necesario para serializar el string
-  // Necesitamos 4 bytes para el tamaño del string y luego los bytes del propio string
-  return 4 + m_strData.size();
+
+void RescueHeader::SetRescatista(Ipv4Address ip) {
+  m_rescatista = ip.Get();
 }
-void MyHeader::Serialize(Buffer::Iterator start) const {
-  // Primero escribimos el tamaño del string, luego el string mismo
-  start.WriteHtonU32(m_strData.size());
-  start.Write((const uint8_t * ) m_strData.c_str(), m_strData.size());
+
+Ipv4Address RescueHeader::GetRescatista(void) const {
+  return Ipv4Address(m_rescatista);
 }
 
-uint32_t MyHeader::Deserialize(Buffer::Iterator start) {
-  // Primero leemos el tamaño del string
-  uint32_t strSize = start.ReadNtohU32();
+void RescueHeader::SetIdSolicitud(uint32_t id) {
+  m_idSolicitud = id;
+}
 
-  // Luego leemos los caracteres del string y lo construimos
-  char strData[strSize + 1]; // +1 para el caracter nulo al final
-  start.Read((uint8_t * ) strData, strSize);
-  strData[strSize] = '\0'; // asegurar que es una cadena terminada en nulo
-  m_strData = std::string(strData);
+uint32_t RescueHeader::GetIdSolicitud(void) const {
+  return m_idSolicitud;
+}
 
-  // Retornamos el tamaño total deserializado
-  return 4 + strSize;
+void RescueHeader::SetTiempoOrigen(Time t) {
+  m_tiempoOrigen = t.GetTimeStep();
 }
 
-void MyHeader::SetData(std::string data) {
-  m_strData = data;
+Time RescueHeader::GetTiempoOrigen(void) const {
+  return TimeStep(m_tiempoOrigen);
 }
 
-std::string MyHeader::GetData(void) const {
-  return m_strData;
+// Header de un paquete agregado por los centrales: el número de mensajes
+// seguido del RescueHeader y del largo de la carga de cada uno. Las cargas
+// van a continuación del header, en el mismo orden.
+class RescueAggregateHeader: public Header {
+  public:
+
+    RescueAggregateHeader();
+  virtual~RescueAggregateHeader();
+
+  void Agregar(const RescueHeader & header, uint16_t largoCarga);
+  uint16_t GetN(void) const;
+  const RescueHeader & GetSubHeader(uint16_t i) const;
+  uint16_t GetLargoCarga(uint16_t i) const;
+
+  static TypeId GetTypeId(void);
+  virtual TypeId GetInstanceTypeId(void) const;
+  virtual void Print(std::ostream & os) const;
+  virtual void Serialize(Buffer::Iterator start) const;
+  virtual uint32_t Deserialize(Buffer::Iterator start);
+  virtual uint32_t GetSerializedSize(void) const;
+
+  // 2 (número de mensajes) y por mensaje el RescueHeader y 2 (largo)
+  static const uint32_t TAMANO_FIJO = 2;
+  static const uint32_t TAMANO_POR_MENSAJE = RescueHeader::SERIALIZED_SIZE + 2;
+
+  private: std::vector < RescueHeader > m_subHeaders;
+  std::vector < uint16_t > m_largos;
+};
+
+RescueAggregateHeader::RescueAggregateHeader() {}
+RescueAggregateHeader::~RescueAggregateHeader() {}
+
+TypeId
+RescueAggregateHeader::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::RescueAggregateHeader")
+    .SetParent < Header > ()
+    .AddConstructor < RescueAggregateHeader > ();
+  return tid;
+}
+TypeId
+RescueAggregateHeader::GetInstanceTypeId(void) const {
+  return GetTypeId();
 }
 
-// Función para escribir en el archivo CSV
 void
-WriteCSVFile(double time, std::string trafficType, Ipv4Address ipSource,
-  Ipv4Address ipDest, int bytesSent) {
-  std::ofstream out(CSVfileName.c_str(), std::ios::app);
+RescueAggregateHeader::Print(std::ostream & os) const {
+  os << "mensajes=" << m_subHeaders.size();
+  for (std::size_t i = 0; i < m_subHeaders.size(); i++) {
+    os << " [";
+    m_subHeaders[i].Print(os);
+    os << " carga=" << m_largos[i] << "]";
+  }
+}
+uint32_t RescueAggregateHeader::GetSerializedSize(void) const {
+  return TAMANO_FIJO + m_subHeaders.size() * TAMANO_POR_MENSAJE;
+}
+void RescueAggregateHeader::Serialize(Buffer::Iterator start) const {
+  start.WriteHtonU16(static_cast < uint16_t > (m_subHeaders.size()));
+  for (std::size_t i = 0; i < m_subHeaders.size(); i++) {
+    m_subHeaders[i].Serialize(start);
+    start.Next(RescueHeader::SERIALIZED_SIZE);
+    start.WriteHtonU16(m_largos[i]);
+  }
+}
 
-  out << time << "," <<
-    trafficType << "," <<
-    ipSource << "," <<
-    ipDest << "," <<
-    bytesSent << "" <<
-    std::endl;
+uint32_t RescueAggregateHeader::Deserialize(Buffer::Iterator start) {
+  uint16_t n = start.ReadNtohU16();
+  m_subHeaders.assign(n, RescueHeader());
+  m_largos.assign(n, 0);
+  for (uint16_t i = 0; i < n; i++) {
+    m_subHeaders[i].Deserialize(start);
+    start.Next(RescueHeader::SERIALIZED_SIZE);
+    m_largos[i] = start.ReadNtohU16();
+  }
+  return GetSerializedSize();
+}
 
-  out.close();
+void RescueAggregateHeader::Agregar(const RescueHeader & header, uint16_t largoCarga) {
+  m_subHeaders.push_back(header);
+  m_largos.push_back(largoCarga);
 }
 
-// Función para imprimir los resultados de la simulación
-void FinalPrint() {
-  std::cout << "---------------------------------------------------------------\n";
-  std::cout << "Resumen de datos\n";
-  std::cout << "Tiempo de simulación: " << simulationTime << " segundos \n";
-  std::cout << "Protocolo de enrutamiento usado: " << routingProtocol << "\n";
-  std::cout << "Número de comunicaciones efectivas: " << comunicacionesEfectivas << "\n";
-  std::cout << "Número de intentos de comunicaciones: " << numeroIntentosComunicacion << "\n";
-  std::cout << "Porcentaje de comunicaciones exitosas: " << (double) comunicacionesEfectivas / numeroIntentosComunicacion * 100 << "\n";
-}
-
-// Función para buscar un nodo con una dirección IP dada
-Ptr < Node > FindNodeWithIpAddressInInterfaces(std::string ipString, Ipv4InterfaceContainer & allInterfaces) {
-  Ipv4Address ip = Ipv4Address(ipString.c_str()); // Convertir string a Ipv4Address
-
-  // Iterar sobre todas las interfaces en el Ipv4InterfaceContainer
-  for (uint32_t i = 0; i < allInterfaces.GetN(); ++i) {
-    Ipv4Address addr = allInterfaces.GetAddress(i);
-    if (addr == ip) {
-      // Obtener la interfaz
-      Ptr < Ipv4 > ipv4 = allInterfaces.Get(i).first;
-      // int32_t interface = allInterfaces.Get(i).second;
-
-      // Buscar el nodo que posee esta interfaz
-      Ptr < Node > node;
-      for (uint32_t j = 0; j < NodeContainer::GetGlobal().GetN(); j++) {
-        node = NodeContainer::GetGlobal().Get(j);
-        if (node -> GetObject < Ipv4 > () == ipv4) {
-          return node; // Nodo encontrado
+uint16_t RescueAggregateHeader::GetN(void) const {
+  return m_subHeaders.size();
+}
+
+const RescueHeader & RescueAggregateHeader::GetSubHeader(uint16_t i) const {
+  return m_subHeaders[i];
+}
+
+uint16_t RescueAggregateHeader::GetLargoCarga(uint16_t i) const {
+  return m_largos[i];
+}
+
+// Byte tag con el instante en que el paquete de una solicitud pasó por una
+// etapa del recorrido. Cada nodo agrega su propio tag al recibir el paquete
+// (los byte tags no se pueden modificar), y el notificador los junta al
+// recibir la respuesta para obtener la latencia de cada tramo.
+enum EtapaRecorrido {
+  ETAPA_NOTIFICADOR_ENVIA = 0,
+  ETAPA_CENTRAL_SOLICITUD = 1,
+  ETAPA_RESCATISTA = 2,
+  ETAPA_CENTRAL_RESPUESTA = 3,
+  NUM_ETAPAS = 4
+};
+
+class EtapaTag: public Tag {
+  public:
+
+    EtapaTag();
+  EtapaTag(uint8_t etapa, Time tiempo);
+
+  uint8_t GetEtapa(void) const;
+  Time GetTiempo(void) const;
+
+  static TypeId GetTypeId(void);
+  virtual TypeId GetInstanceTypeId(void) const;
+  virtual uint32_t GetSerializedSize(void) const;
+  virtual void Serialize(TagBuffer i) const;
+  virtual void Deserialize(TagBuffer i);
+  virtual void Print(std::ostream & os) const;
+
+  private: uint8_t m_etapa;
+  int64_t m_tiempo;
+};
+
+EtapaTag::EtapaTag(): m_etapa(0),
+  m_tiempo(0) {}
+
+EtapaTag::EtapaTag(uint8_t etapa, Time tiempo): m_etapa(etapa),
+  m_tiempo(tiempo.GetTimeStep()) {}
+
+TypeId
+EtapaTag::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::EtapaTag")
+    .SetParent < Tag > ()
+    .AddConstructor < EtapaTag > ();
+  return tid;
+}
+TypeId
+EtapaTag::GetInstanceTypeId(void) const {
+  return GetTypeId();
+}
+
+uint32_t EtapaTag::GetSerializedSize(void) const {
+  return 1 + 8;
+}
+
+void EtapaTag::Serialize(TagBuffer i) const {
+  i.WriteU8(m_etapa);
+  i.WriteU64(static_cast < uint64_t > (m_tiempo));
+}
+
+void EtapaTag::Deserialize(TagBuffer i) {
+  m_etapa = i.ReadU8();
+  m_tiempo = static_cast < int64_t > (i.ReadU64());
+}
+
+void EtapaTag::Print(std::ostream & os) const {
+  os << "etapa=" << static_cast < uint32_t > (m_etapa) << " t=" << TimeStep(m_tiempo).As(Time::S);
+}
+
+uint8_t EtapaTag::GetEtapa(void) const {
+  return m_etapa;
+}
+
+Time EtapaTag::GetTiempo(void) const {
+  return TimeStep(m_tiempo);
+}
+
+// Distancia a la que la potencia recibida con el modelo de pérdidas cae por
+// debajo de la sensibilidad, por búsqueda binaria (el modelo debe ser
+// monótono con la distancia)
+double RangoRecepcion(Ptr < PropagationLossModel > loss, double txDbm, double sensibilidadDbm) {
+  Ptr < ConstantPositionMobilityModel > a = CreateObject < ConstantPositionMobilityModel > ();
+  Ptr < ConstantPositionMobilityModel > b = CreateObject < ConstantPositionMobilityModel > ();
+  a -> SetPosition(Vector(0, 0, 0));
+  double lo = 0;
+  double hi = 1e6;
+  for (int i = 0; i < 64; i++) {
+    double mid = (lo + hi) / 2;
+    b -> SetPosition(Vector(mid, 0, 0));
+    if (loss -> CalcRxPower(txDbm, a, b) >= sensibilidadDbm) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return hi;
+}
+
+// Canal wifi con índice espacial. YansWifiChannel entrega cada transmisión
+// a todos los demás PHY y calcula la pérdida para cada uno (O(N) por
+// paquete, O(N²) con las inundaciones de AODV o los HELLO de OLSR). Este
+// canal mantiene una malla uniforme sobre las posiciones de los nodos,
+// actualizada con las notificaciones CourseChange de la movilidad y un
+// refresco periódico, y sólo entrega la transmisión a los receptores que
+// están dentro del rango de corte. El rango de corte se deriva de la
+// sensibilidad de recepción y del modelo de pérdidas si no se indica.
+//
+// YansWifiChannel::Send no es virtual, por eso los PHY que usan este canal
+// son GridYansWifiPhy, que redirigen StartTx hacia GridWifiChannel::Send.
+class GridWifiChannel: public YansWifiChannel {
+  public:
+
+    static TypeId GetTypeId(void);
+
+  GridWifiChannel();
+  virtual~GridWifiChannel();
+
+  void SetPropagationLossModel(const Ptr < PropagationLossModel > loss);
+  void SetPropagationDelayModel(const Ptr < PropagationDelayModel > delay);
+
+  void Send(Ptr < YansWifiPhy > sender, Ptr <
+    const WifiPpdu > ppdu, double txPowerDbm);
+
+  double GetCutoffRange(void) const;
+  uint64_t GetEntregas(void) const;
+  uint64_t GetOmitidos(void) const;
+
+  private:
+    struct EntradaPhy {
+      Ptr < YansWifiPhy > phy;
+      Ptr < MobilityModel > mobility;
+      uint64_t celda;
+      uint32_t posicionEnCelda;
+    };
+
+  static void Receive(Ptr < YansWifiPhy > receiver, Ptr < WifiPpdu > ppdu, double rxPowerDbm);
+
+  void Construir(void);
+  double CalcularRangoCorte(void) const;
+  uint64_t Celda(const Vector & posicion) const;
+  void Ubicar(uint32_t indice);
+  void Refrescar(void);
+  void CourseChanged(Ptr <
+    const MobilityModel > mobility);
+
+  Ptr < PropagationLossModel > m_loss;
+  Ptr < PropagationDelayModel > m_delay;
+  double m_cutoffRange;
+  double m_slack;
+  Time m_refreshInterval;
+  double m_tamanoCelda;
+  bool m_construido;
+
+  std::vector < EntradaPhy > m_phys;
+  std::unordered_map < uint64_t, std::vector < uint32_t > > m_celdas;
+  std::unordered_map < const MobilityModel * , uint32_t > m_porMovilidad;
+  std::unordered_map < const YansWifiPhy * , uint32_t > m_porPhy;
+
+  uint64_t m_entregas;
+  uint64_t m_omitidos;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(GridWifiChannel);
+
+TypeId
+GridWifiChannel::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::GridWifiChannel")
+    .SetParent < YansWifiChannel > ()
+    .AddConstructor < GridWifiChannel > ()
+    .AddAttribute("CutoffRange",
+      "Distancia máxima (m) a la que se entrega una transmisión (0 = derivar de la sensibilidad de recepción)",
+      DoubleValue(0),
+      MakeDoubleAccessor( & GridWifiChannel::m_cutoffRange),
+      MakeDoubleChecker < double > (0))
+    .AddAttribute("PositionSlack",
+      "Margen (m) que se suma al rango de corte al buscar candidatos en la malla, "
+      "para cubrir el movimiento de los nodos entre actualizaciones",
+      DoubleValue(10),
+      MakeDoubleAccessor( & GridWifiChannel::m_slack),
+      MakeDoubleChecker < double > (0))
+    .AddAttribute("RefreshInterval",
+      "Intervalo de reubicación de todos los nodos en la malla",
+      TimeValue(Seconds(1)),
+      MakeTimeAccessor( & GridWifiChannel::m_refreshInterval),
+      MakeTimeChecker());
+  return tid;
+}
+
+GridWifiChannel::GridWifiChannel(): m_cutoffRange(0),
+  m_slack(10),
+  m_tamanoCelda(0),
+  m_construido(false),
+  m_entregas(0),
+  m_omitidos(0) {}
+
+GridWifiChannel::~GridWifiChannel() {}
+
+void GridWifiChannel::SetPropagationLossModel(const Ptr < PropagationLossModel > loss) {
+  // Se guarda una copia porque los modelos de YansWifiChannel son privados
+  m_loss = loss;
+  YansWifiChannel::SetPropagationLossModel(loss);
+}
+
+void GridWifiChannel::SetPropagationDelayModel(const Ptr < PropagationDelayModel > delay) {
+  m_delay = delay;
+  YansWifiChannel::SetPropagationDelayModel(delay);
+}
+
+double GridWifiChannel::GetCutoffRange(void) const {
+  return m_cutoffRange;
+}
+
+uint64_t GridWifiChannel::GetEntregas(void) const {
+  return m_entregas;
+}
+
+uint64_t GridWifiChannel::GetOmitidos(void) const {
+  return m_omitidos;
+}
+
+double GridWifiChannel::CalcularRangoCorte(void) const {
+  // Mayor potencia de transmisión y menor sensibilidad de todos los PHY
+  double txMax = -1e9;
+  double sensibilidadMin = 1e9;
+  for (const EntradaPhy & e: m_phys) {
+    txMax = std::max(txMax, e.phy -> GetTxPowerEnd() + e.phy -> GetTxGain());
+    sensibilidadMin = std::min(sensibilidadMin, e.phy -> GetRxSensitivity() - e.phy -> GetRxGain());
+  }
+  return RangoRecepcion(m_loss, txMax, sensibilidadMin);
+}
+
+void GridWifiChannel::Construir(void) {
+  m_construido = true;
+  for (std::size_t i = 0; i < GetNDevices(); i++) {
+    Ptr < WifiNetDevice > device = DynamicCast < WifiNetDevice > (GetDevice(i));
+    NS_ASSERT(device);
+    Ptr < YansWifiPhy > phy = DynamicCast < YansWifiPhy > (device -> GetPhy());
+    EntradaPhy e;
+    e.phy = phy;
+    e.mobility = phy -> GetMobility();
+    NS_ASSERT_MSG(e.mobility, "GridWifiChannel requiere un modelo de movilidad en cada nodo");
+    e.celda = 0;
+    e.posicionEnCelda = 0;
+    m_porMovilidad[PeekPointer(e.mobility)] = m_phys.size();
+    m_porPhy[PeekPointer(phy)] = m_phys.size();
+    m_phys.push_back(e);
+  }
+
+  if (m_cutoffRange <= 0) {
+    m_cutoffRange = CalcularRangoCorte();
+  }
+  m_tamanoCelda = m_cutoffRange + m_slack;
+
+  for (uint32_t i = 0; i < m_phys.size(); i++) {
+    m_phys[i].mobility -> TraceConnectWithoutContext("CourseChange",
+      MakeCallback( & GridWifiChannel::CourseChanged, this));
+    m_phys[i].celda = Celda(m_phys[i].mobility -> GetPosition());
+    std::vector < uint32_t > & celda = m_celdas[m_phys[i].celda];
+    m_phys[i].posicionEnCelda = celda.size();
+    celda.push_back(i);
+  }
+  if (!m_refreshInterval.IsZero()) {
+    Simulator::Schedule(m_refreshInterval, & GridWifiChannel::Refrescar, this);
+  }
+}
+
+uint64_t GridWifiChannel::Celda(const Vector & posicion) const {
+  int32_t cx = static_cast < int32_t > (std::floor(posicion.x / m_tamanoCelda));
+  int32_t cy = static_cast < int32_t > (std::floor(posicion.y / m_tamanoCelda));
+  return (static_cast < uint64_t > (static_cast < uint32_t > (cx)) << 32) | static_cast < uint32_t > (cy);
+}
+
+void GridWifiChannel::Ubicar(uint32_t indice) {
+  EntradaPhy & e = m_phys[indice];
+  uint64_t nueva = Celda(e.mobility -> GetPosition());
+  if (nueva == e.celda) {
+    return;
+  }
+  // Sacar de la celda anterior intercambiando con el último elemento
+  std::vector < uint32_t > & anterior = m_celdas[e.celda];
+  uint32_t ultimo = anterior.back();
+  anterior[e.posicionEnCelda] = ultimo;
+  m_phys[ultimo].posicionEnCelda = e.posicionEnCelda;
+  anterior.pop_back();
+
+  std::vector < uint32_t > & celda = m_celdas[nueva];
+  e.celda = nueva;
+  e.posicionEnCelda = celda.size();
+  celda.push_back(indice);
+}
+
+void GridWifiChannel::Refrescar(void) {
+  for (uint32_t i = 0; i < m_phys.size(); i++) {
+    Ubicar(i);
+  }
+  Simulator::Schedule(m_refreshInterval, & GridWifiChannel::Refrescar, this);
+}
+
+void GridWifiChannel::CourseChanged(Ptr <
+  const MobilityModel > mobility) {
+  auto it = m_porMovilidad.find(PeekPointer(mobility));
+  if (it != m_porMovilidad.end()) {
+    Ubicar(it -> second);
+  }
+}
+
+void GridWifiChannel::Send(Ptr < YansWifiPhy > sender, Ptr <
+  const WifiPpdu > ppdu, double txPowerDbm) {
+  if (!m_construido) {
+    Construir();
+  }
+  Ptr < MobilityModel > senderMobility = sender -> GetMobility();
+  Vector p = senderMobility -> GetPosition();
+  int32_t cx = static_cast < int32_t > (std::floor(p.x / m_tamanoCelda));
+  int32_t cy = static_cast < int32_t > (std::floor(p.y / m_tamanoCelda));
+
+  // Receptores a los que se programó la recepción; el resto (otras celdas,
+  // otro canal o más allá del rango de corte) cuenta como omitido
+  uint64_t entregados = 0;
+  // Con celdas del tamaño del rango más el margen basta revisar las 3x3
+  // celdas vecinas
+  for (int32_t dx = -1; dx <= 1; dx++) {
+    for (int32_t dy = -1; dy <= 1; dy++) {
+      uint64_t clave = (static_cast < uint64_t > (static_cast < uint32_t > (cx + dx)) << 32) |
+        static_cast < uint32_t > (cy + dy);
+      auto it = m_celdas.find(clave);
+      if (it == m_celdas.end()) {
+        continue;
+      }
+      for (uint32_t indice: it -> second) {
+        const EntradaPhy & e = m_phys[indice];
+        if (e.phy == sender || e.phy -> GetChannelNumber() != sender -> GetChannelNumber()) {
+          continue;
         }
+        if (senderMobility -> GetDistanceFrom(e.mobility) > m_cutoffRange) {
+          continue;
+        }
+        Time delay = m_delay -> GetDelay(senderMobility, e.mobility);
+        double rxPowerDbm = m_loss -> CalcRxPower(txPowerDbm, senderMobility, e.mobility);
+        Ptr < WifiPpdu > copy = ppdu -> Copy();
+        Ptr < NetDevice > dstNetDevice = e.phy -> GetDevice();
+        uint32_t dstNode = dstNetDevice ? dstNetDevice -> GetNode() -> GetId() : 0xffffffff;
+        Simulator::ScheduleWithContext(dstNode, delay, & GridWifiChannel::Receive, e.phy, copy, rxPowerDbm);
+        entregados++;
       }
     }
   }
+  m_entregas += entregados;
+  m_omitidos += m_phys.size() - 1 - std::min < uint64_t > (entregados, m_phys.size() - 1);
+}
+
+void GridWifiChannel::Receive(Ptr < YansWifiPhy > phy, Ptr < WifiPpdu > ppdu, double rxPowerDbm) {
+  // Igual que YansWifiChannel::Receive (privado): se descarta la señal por
+  // debajo de la sensibilidad y se entrega al PHY con una banda ficticia
+  if ((rxPowerDbm + phy -> GetRxGain()) < phy -> GetRxSensitivity()) {
+    return;
+  }
+  RxPowerWattPerChannelBand rxPowerW;
+  rxPowerW.insert({{{0, 0}, {0, 0}}, DbmToW(rxPowerDbm + phy -> GetRxGain())});
+  phy -> StartReceivePreamble(ppdu, rxPowerW, ppdu -> GetTxDuration());
+}
+
+// PHY Yans que transmite a través de GridWifiChannel cuando está conectado
+// a uno; con un YansWifiChannel normal se comporta igual que YansWifiPhy
+class GridYansWifiPhy: public YansWifiPhy {
+  public:
+
+    static TypeId GetTypeId(void);
+
+  GridYansWifiPhy();
+  virtual~GridYansWifiPhy();
+
+  virtual void StartTx(Ptr <
+    const WifiPpdu > ppdu);
+};
+
+NS_OBJECT_ENSURE_REGISTERED(GridYansWifiPhy);
+
+TypeId
+GridYansWifiPhy::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::GridYansWifiPhy")
+    .SetParent < YansWifiPhy > ()
+    .AddConstructor < GridYansWifiPhy > ();
+  return tid;
+}
+
+GridYansWifiPhy::GridYansWifiPhy() {}
+
+GridYansWifiPhy::~GridYansWifiPhy() {}
+
+void GridYansWifiPhy::StartTx(Ptr <
+  const WifiPpdu > ppdu) {
+  Ptr < GridWifiChannel > canal = DynamicCast < GridWifiChannel > (GetChannel());
+  if (!canal) {
+    YansWifiPhy::StartTx(ppdu);
+    return;
+  }
+  canal -> Send(this, ppdu, GetTxPowerForTransmission(ppdu) + GetTxGain());
+}
+
+// Helper que instala GridYansWifiPhy en lugar de YansWifiPhy
+class GridYansWifiPhyHelper: public YansWifiPhyHelper {
+  public:
+
+    GridYansWifiPhyHelper();
+};
+
+GridYansWifiPhyHelper::GridYansWifiPhyHelper() {
+  m_phys.front().SetTypeId("ns3::GridYansWifiPhy");
+}
+
+// Movilidad precalculada. RandomWalk2dMobilityModel sortea rumbo y
+// velocidad y programa un evento por cada cambio de rumbo de cada nodo
+// durante toda la corrida. Con --movilidad=precalculada los recorridos de
+// notificadores y rescatistas se generan una sola vez antes de la corrida
+// (o se cargan de un archivo) como listas de puntos de paso, y
+// TraceWaypointMobilityModel los reproduce interpolando entre los dos
+// puntos que rodean al instante actual. Los recorridos no dependen de los
+// eventos de la simulación, así que AODV, OLSR y DSDV ven el mismo
+// movimiento.
+//
+// Archivo binario de recorridos (orden de bytes del host):
+//   MobilityTraceHeader      encabezado fijo de 64 bytes
+//   uint64_t inicio[n + 1]   índice del primer punto de cada nodo
+//   PuntoRecorrido puntos[]  ordenados por nodo y, dentro de cada nodo, por tiempo
+//
+// También se aceptan trazas de movimiento de ns-2:
+//   $node_(i) set X_ 10.0
+//   $ns_ at 2.0 "$node_(i) setdest 30.0 40.0 1.5"
+static const char MOVILIDAD_MAGIC[] = "RSCMOVIL";
+static const uint32_t MOVILIDAD_VERSION = 1;
+
+struct MobilityTraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numNodos;
+  uint64_t numPuntos;
+  uint32_t seed;
+  uint32_t reservado0;
+  uint64_t run;
+  double duracion;
+  double limiteArea;
+  uint8_t reservado[8];
+};
+
+static_assert(sizeof(MobilityTraceHeader) == 64, "El encabezado de los recorridos debe ocupar 64 bytes");
+
+struct PuntoRecorrido {
+  int64_t tiempoNs;
+  float x;
+  float y;
+};
+
+// Modelo de movilidad que reproduce un recorrido precalculado. No programa
+// eventos: la posición se calcula al consultarla, buscando el tramo actual
+// primero junto al de la consulta anterior y si no con búsqueda binaria.
+class TraceWaypointMobilityModel: public MobilityModel {
+  public:
+
+    static TypeId GetTypeId(void);
+
+  TraceWaypointMobilityModel();
+  virtual~TraceWaypointMobilityModel();
+
+  // Los puntos pertenecen a MobilityTrace, que debe vivir más que el modelo
+  void SetRecorrido(const PuntoRecorrido * puntos, uint32_t numPuntos);
+  // Notifica CourseChange si el nodo se movió desde la última notificación
+  void NotificarSiSeMovio(void);
+
+  private:
+    virtual Vector DoGetPosition(void) const;
+  virtual void DoSetPosition(const Vector & position);
+  virtual Vector DoGetVelocity(void) const;
+  uint32_t Tramo(int64_t tiempoNs) const;
+
+  const PuntoRecorrido * m_puntos;
+  uint32_t m_numPuntos;
+  mutable uint32_t m_ultimo;
+  Vector m_posicionFija;
+  Vector m_ultimaNotificada;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TraceWaypointMobilityModel);
+
+TypeId
+TraceWaypointMobilityModel::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::TraceWaypointMobilityModel")
+    .SetParent < MobilityModel > ()
+    .AddConstructor < TraceWaypointMobilityModel > ();
+  return tid;
+}
+
+TraceWaypointMobilityModel::TraceWaypointMobilityModel(): m_puntos(nullptr),
+  m_numPuntos(0),
+  m_ultimo(0) {}
+
+TraceWaypointMobilityModel::~TraceWaypointMobilityModel() {}
+
+void TraceWaypointMobilityModel::SetRecorrido(const PuntoRecorrido * puntos, uint32_t numPuntos) {
+  m_puntos = puntos;
+  m_numPuntos = numPuntos;
+  m_ultimo = 0;
+  m_ultimaNotificada = DoGetPosition();
+}
+
+uint32_t TraceWaypointMobilityModel::Tramo(int64_t tiempoNs) const {
+  // Caso común: la consulta cae en el mismo tramo que la anterior o en el
+  // siguiente
+  if (m_puntos[m_ultimo].tiempoNs <= tiempoNs) {
+    if (m_ultimo + 1 >= m_numPuntos || tiempoNs < m_puntos[m_ultimo + 1].tiempoNs) {
+      return m_ultimo;
+    }
+    if (m_ultimo + 2 >= m_numPuntos || tiempoNs < m_puntos[m_ultimo + 2].tiempoNs) {
+      return ++m_ultimo;
+    }
+  }
+  const PuntoRecorrido * fin = m_puntos + m_numPuntos;
+  const PuntoRecorrido * it = std::upper_bound(m_puntos, fin, tiempoNs,
+    [](int64_t t,
+      const PuntoRecorrido & p) {
+      return t < p.tiempoNs;
+    });
+  m_ultimo = (it == m_puntos) ? 0 : static_cast < uint32_t > (it - m_puntos - 1);
+  return m_ultimo;
+}
+
+Vector TraceWaypointMobilityModel::DoGetPosition(void) const {
+  if (m_numPuntos == 0) {
+    return m_posicionFija;
+  }
+  int64_t ahora = Simulator::Now().GetNanoSeconds();
+  uint32_t i = Tramo(ahora);
+  const PuntoRecorrido & a = m_puntos[i];
+  if (i + 1 >= m_numPuntos || ahora <= a.tiempoNs) {
+    return Vector(a.x, a.y, 0);
+  }
+  const PuntoRecorrido & b = m_puntos[i + 1];
+  double f = static_cast < double > (ahora - a.tiempoNs) / (b.tiempoNs - a.tiempoNs);
+  return Vector(a.x + f * (b.x - a.x), a.y + f * (b.y - a.y), 0);
+}
+
+void TraceWaypointMobilityModel::DoSetPosition(const Vector & position) {
+  // Fijar la posición abandona el recorrido
+  m_numPuntos = 0;
+  m_posicionFija = position;
+  m_ultimaNotificada = position;
+  NotifyCourseChange();
+}
+
+Vector TraceWaypointMobilityModel::DoGetVelocity(void) const {
+  if (m_numPuntos == 0) {
+    return Vector(0, 0, 0);
+  }
+  int64_t ahora = Simulator::Now().GetNanoSeconds();
+  uint32_t i = Tramo(ahora);
+  if (i + 1 >= m_numPuntos || ahora < m_puntos[i].tiempoNs) {
+    return Vector(0, 0, 0);
+  }
+  const PuntoRecorrido & a = m_puntos[i];
+  const PuntoRecorrido & b = m_puntos[i + 1];
+  double segundos = (b.tiempoNs - a.tiempoNs) / 1e9;
+  return Vector((b.x - a.x) / segundos, (b.y - a.y) / segundos, 0);
+}
+
+void TraceWaypointMobilityModel::NotificarSiSeMovio(void) {
+  Vector p = DoGetPosition();
+  if (p.x != m_ultimaNotificada.x || p.y != m_ultimaNotificada.y) {
+    m_ultimaNotificada = p;
+    NotifyCourseChange();
+  }
+}
+
+// Recorridos de todos los nodos móviles en un solo arreglo, indexado por
+// nodo como en el archivo binario. Se generan con la misma caminata que
+// RandomWalk2dMobilityModel o se cargan de un archivo, y se instalan como
+// TraceWaypointMobilityModel en los nodos. Como los modelos no generan
+// eventos, un único evento periódico avisa CourseChange a la malla del
+// canal espacial y al selector de rescatistas.
+class MobilityTrace {
+  public:
+
+    MobilityTrace();
+
+  void Generar(const std::vector < Vector > & iniciales, double duracion, double limiteArea,
+    Ptr < UniformRandomVariable > aleatorio);
+  bool Cargar(const std::string & fileName, std::string & error);
+  bool Guardar(const std::string & fileName) const;
+  void Instalar(const NodeContainer & nodos, Time intervaloNotificacion);
+
+  uint32_t GetNumNodos(void) const;
+  uint64_t GetNumPuntos(void) const;
+  double GetDuracion(void) const;
+  double GetLimiteArea(void) const;
+  double GetVelocidadMaxima(void) const;
+  Vector GetPosicionInicial(uint32_t nodo) const;
+  // Semilla y corrida con que se generaron; false si el archivo era ns-2
+  bool GetOrigen(uint32_t & seed, uint64_t & run) const;
+
+  private:
+    bool CargarBinario(std::ifstream & in, const std::string & fileName, std::string & error);
+  bool CargarNs2(std::ifstream & in, const std::string & fileName, std::string & error);
+  void NotificarCambios(void);
+
+  // Mismos valores por defecto que RandomWalk2dMobilityModel en modo
+  // distancia: tramos de 1 m, rumbo uniforme y velocidad entre 2 y 4 m/s
+  static constexpr double DISTANCIA_TRAMO = 1.0;
+  static constexpr double VELOCIDAD_MIN = 2.0;
+  static constexpr double VELOCIDAD_MAX = 4.0;
+
+  double m_duracion;
+  double m_limiteArea;
+  bool m_conOrigen;
+  uint32_t m_seed;
+  uint64_t m_run;
+  std::vector < uint64_t > m_inicio;
+  std::vector < PuntoRecorrido > m_puntos;
+  std::vector < Ptr < TraceWaypointMobilityModel > > m_modelos;
+  Time m_intervalo;
+};
+
+MobilityTrace::MobilityTrace(): m_duracion(0),
+  m_limiteArea(0),
+  m_conOrigen(false),
+  m_seed(0),
+  m_run(0),
+  m_inicio(1, 0) {}
+
+void MobilityTrace::Generar(const std::vector < Vector > & iniciales, double duracion, double limiteArea,
+  Ptr < UniformRandomVariable > aleatorio) {
+  m_duracion = duracion;
+  m_limiteArea = limiteArea;
+  m_conOrigen = true;
+  m_seed = RngSeedManager::GetSeed();
+  m_run = RngSeedManager::GetRun();
+  m_inicio.assign(1, 0);
+  m_puntos.clear();
+  // Unos 3 tramos por segundo por nodo, más los cortes en los bordes
+  m_puntos.reserve(iniciales.size() * static_cast < std::size_t > (4 * duracion + 2));
+  int64_t finNs = static_cast < int64_t > (duracion * 1e9);
+  for (const Vector & inicial: iniciales) {
+    double x = std::min(std::max(inicial.x, -limiteArea), limiteArea);
+    double y = std::min(std::max(inicial.y, -limiteArea), limiteArea);
+    double t = 0;
+    m_puntos.push_back({0, static_cast < float > (x), static_cast < float > (y)});
+    while (static_cast < int64_t > (t * 1e9) < finNs) {
+      double rumbo = aleatorio -> GetValue(0, 2 * M_PI);
+      double velocidad = aleatorio -> GetValue(VELOCIDAD_MIN, VELOCIDAD_MAX);
+      double vx = velocidad * std::cos(rumbo);
+      double vy = velocidad * std::sin(rumbo);
+      double restante = DISTANCIA_TRAMO / velocidad;
+      while (restante > 0) {
+        // Rebote en los bordes: se invierte la componente que sale del área
+        if ((x >= limiteArea && vx > 0) || (x <= -limiteArea && vx < 0)) {
+          vx = -vx;
+        }
+        if ((y >= limiteArea && vy > 0) || (y <= -limiteArea && vy < 0)) {
+          vy = -vy;
+        }
+        double paso = restante;
+        if (vx != 0) {
+          paso = std::min(paso, ((vx > 0 ? limiteArea : -limiteArea) - x) / vx);
+        }
+        if (vy != 0) {
+          paso = std::min(paso, ((vy > 0 ? limiteArea : -limiteArea) - y) / vy);
+        }
+        x = std::min(std::max(x + vx * paso, -limiteArea), limiteArea);
+        y = std::min(std::max(y + vy * paso, -limiteArea), limiteArea);
+        t += paso;
+        restante -= paso;
+        m_puntos.push_back({static_cast < int64_t > (t * 1e9), static_cast < float > (x), static_cast < float > (y)});
+      }
+    }
+    m_inicio.push_back(m_puntos.size());
+  }
+}
+
+bool MobilityTrace::Cargar(const std::string & fileName, std::string & error) {
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!in.is_open()) {
+    error = "no se pudo abrir " + fileName;
+    return false;
+  }
+  char magic[sizeof(MobilityTraceHeader::magic)] = {};
+  in.read(magic, sizeof(magic));
+  in.clear();
+  in.seekg(0);
+  m_inicio.assign(1, 0);
+  m_puntos.clear();
+  if (std::memcmp(magic, MOVILIDAD_MAGIC, sizeof(magic)) == 0) {
+    return CargarBinario(in, fileName, error);
+  }
+  return CargarNs2(in, fileName, error);
+}
+
+bool MobilityTrace::CargarBinario(std::ifstream & in, const std::string & fileName, std::string & error) {
+  MobilityTraceHeader h;
+  if (!in.read(reinterpret_cast < char * > ( & h), sizeof(h)) || h.version != MOVILIDAD_VERSION) {
+    error = fileName + ": versión de recorridos no soportada";
+    return false;
+  }
+  m_inicio.resize(static_cast < std::size_t > (h.numNodos) + 1);
+  m_puntos.resize(h.numPuntos);
+  in.read(reinterpret_cast < char * > (m_inicio.data()), m_inicio.size() * sizeof(uint64_t));
+  in.read(reinterpret_cast < char * > (m_puntos.data()), m_puntos.size() * sizeof(PuntoRecorrido));
+  if (!in) {
+    error = fileName + " está truncado";
+    return false;
+  }
+  for (uint32_t i = 0; i < h.numNodos; i++) {
+    if (m_inicio[i] >= m_inicio[i + 1]) {
+      error = fileName + ": el nodo " + std::to_string(i) + " no tiene puntos";
+      return false;
+    }
+  }
+  if (m_inicio.front() != 0 || m_inicio.back() != h.numPuntos) {
+    error = fileName + ": índice de nodos inconsistente";
+    return false;
+  }
+  m_duracion = h.duracion;
+  m_limiteArea = h.limiteArea;
+  m_conOrigen = true;
+  m_seed = h.seed;
+  m_run = h.run;
+  return true;
+}
+
+bool MobilityTrace::CargarNs2(std::ifstream & in, const std::string & fileName, std::string & error) {
+  struct Destino {
+    double tiempo;
+    double x;
+    double y;
+    double velocidad;
+  };
+  std::vector < Vector > iniciales;
+  std::vector < std::vector < Destino > > destinos;
+  std::string linea;
+  uint32_t numeroLinea = 0;
+  while (std::getline(in, linea)) {
+    numeroLinea++;
+    unsigned nodo = 0;
+    char eje = 0;
+    double valor = 0;
+    Destino d;
+    if (std::sscanf(linea.c_str(), " $node_(%u) set %c_ %lf", & nodo, & eje, & valor) == 3) {
+      if (nodo >= iniciales.size()) {
+        iniciales.resize(nodo + 1);
+        destinos.resize(nodo + 1);
+      }
+      if (eje == 'X') {
+        iniciales[nodo].x = valor;
+      } else if (eje == 'Y') {
+        iniciales[nodo].y = valor;
+      }
+    } else if (std::sscanf(linea.c_str(), " $ns_ at %lf \"$node_(%u) setdest %lf %lf %lf",
+        & d.tiempo, & nodo, & d.x, & d.y, & d.velocidad) == 5) {
+      if (nodo >= iniciales.size()) {
+        iniciales.resize(nodo + 1);
+        destinos.resize(nodo + 1);
+      }
+      destinos[nodo].push_back(d);
+    } else if (linea.find_first_not_of(" \t\r") != std::string::npos && linea[linea.find_first_not_of(" \t\r")] != '#') {
+      error = fileName + ":" + std::to_string(numeroLinea) + ": línea no reconocida";
+      return false;
+    }
+  }
+  if (iniciales.empty()) {
+    error = fileName + " no tiene nodos";
+    return false;
+  }
+
+  m_duracion = 0;
+  m_limiteArea = 0;
+  m_conOrigen = false;
+  for (uint32_t i = 0; i < iniciales.size(); i++) {
+    std::stable_sort(destinos[i].begin(), destinos[i].end(),
+      [](const Destino & a,
+        const Destino & b) {
+        return a.tiempo < b.tiempo;
+      });
+    std::size_t primero = m_puntos.size();
+    m_puntos.push_back({0, static_cast < float > (iniciales[i].x), static_cast < float > (iniciales[i].y)});
+    for (const Destino & d: destinos[i]) {
+      int64_t t = std::max < int64_t > (static_cast < int64_t > (d.tiempo * 1e9), 0);
+      PuntoRecorrido & ultimo = m_puntos.back();
+      if (t < ultimo.tiempoNs) {
+        // Nuevo destino antes de llegar al anterior: el tramo en curso se
+        // corta donde está el nodo en ese instante
+        const PuntoRecorrido & a = m_puntos[m_puntos.size() - 2];
+        if (t == a.tiempoNs) {
+          m_puntos.pop_back();
+        } else {
+          double f = static_cast < double > (t - a.tiempoNs) / (ultimo.tiempoNs - a.tiempoNs);
+          ultimo.x = a.x + f * (ultimo.x - a.x);
+          ultimo.y = a.y + f * (ultimo.y - a.y);
+          ultimo.tiempoNs = t;
+        }
+      } else if (t > ultimo.tiempoNs) {
+        // Quieto hasta recibir el destino
+        m_puntos.push_back({t, ultimo.x, ultimo.y});
+      }
+      const PuntoRecorrido & desde = m_puntos.back();
+      double distancia = std::hypot(d.x - desde.x, d.y - desde.y);
+      if (d.velocidad <= 0 || distancia == 0) {
+        continue;
+      }
+      m_puntos.push_back({t + static_cast < int64_t > (distancia / d.velocidad * 1e9),
+        static_cast < float > (d.x), static_cast < float > (d.y)});
+    }
+    for (std::size_t j = primero; j < m_puntos.size(); j++) {
+      m_limiteArea = std::max(m_limiteArea, static_cast < double > (std::max(std::abs(m_puntos[j].x), std::abs(m_puntos[j].y))));
+    }
+    m_duracion = std::max(m_duracion, m_puntos.back().tiempoNs / 1e9);
+    m_inicio.push_back(m_puntos.size());
+  }
+  return true;
+}
+
+// Se escribe en un temporal y se renombra, para que otro proceso que lea el
+// mismo archivo (escenarios en paralelo) nunca vea uno a medio escribir
+bool MobilityTrace::Guardar(const std::string & fileName) const {
+  std::string temporal = fileName + ".tmp." + std::to_string(getpid());
+  std::ofstream out(temporal.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!out.is_open()) {
+    return false;
+  }
+  MobilityTraceHeader h;
+  std::memset( & h, 0, sizeof(h));
+  std::memcpy(h.magic, MOVILIDAD_MAGIC, sizeof(h.magic));
+  h.version = MOVILIDAD_VERSION;
+  h.numNodos = GetNumNodos();
+  h.numPuntos = m_puntos.size();
+  h.seed = m_seed;
+  h.run = m_run;
+  h.duracion = m_duracion;
+  h.limiteArea = m_limiteArea;
+  out.write(reinterpret_cast < const char * > ( & h), sizeof(h));
+  out.write(reinterpret_cast < const char * > (m_inicio.data()), m_inicio.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast < const char * > (m_puntos.data()), m_puntos.size() * sizeof(PuntoRecorrido));
+  out.close();
+  if (!out || std::rename(temporal.c_str(), fileName.c_str()) != 0) {
+    std::remove(temporal.c_str());
+    return false;
+  }
+  return true;
+}
+
+void MobilityTrace::Instalar(const NodeContainer & nodos, Time intervaloNotificacion) {
+  NS_ABORT_MSG_IF(nodos.GetN() > GetNumNodos(), "Los recorridos tienen " << GetNumNodos() <<
+    " nodos y el escenario necesita " << nodos.GetN());
+  m_modelos.clear();
+  for (uint32_t i = 0; i < nodos.GetN(); i++) {
+    Ptr < TraceWaypointMobilityModel > modelo = CreateObject < TraceWaypointMobilityModel > ();
+    modelo -> SetRecorrido(m_puntos.data() + m_inicio[i], m_inicio[i + 1] - m_inicio[i]);
+    nodos.Get(i) -> AggregateObject(modelo);
+    m_modelos.push_back(modelo);
+  }
+  m_intervalo = intervaloNotificacion;
+  if (!m_intervalo.IsZero()) {
+    Simulator::Schedule(m_intervalo, & MobilityTrace::NotificarCambios, this);
+  }
+}
+
+void MobilityTrace::NotificarCambios(void) {
+  for (Ptr < TraceWaypointMobilityModel > & modelo: m_modelos) {
+    modelo -> NotificarSiSeMovio();
+  }
+  Simulator::Schedule(m_intervalo, & MobilityTrace::NotificarCambios, this);
+}
+
+uint32_t MobilityTrace::GetNumNodos(void) const {
+  return m_inicio.size() - 1;
+}
+
+uint64_t MobilityTrace::GetNumPuntos(void) const {
+  return m_puntos.size();
+}
+
+double MobilityTrace::GetDuracion(void) const {
+  return m_duracion;
+}
+
+double MobilityTrace::GetLimiteArea(void) const {
+  return m_limiteArea;
+}
+
+double MobilityTrace::GetVelocidadMaxima(void) const {
+  double maxima = 0;
+  for (uint32_t n = 0; n < GetNumNodos(); n++) {
+    for (uint64_t j = m_inicio[n] + 1; j < m_inicio[n + 1]; j++) {
+      const PuntoRecorrido & a = m_puntos[j - 1];
+      const PuntoRecorrido & b = m_puntos[j];
+      if (b.tiempoNs > a.tiempoNs) {
+        maxima = std::max(maxima, std::hypot(b.x - a.x, b.y - a.y) / ((b.tiempoNs - a.tiempoNs) / 1e9));
+      }
+    }
+  }
+  return maxima;
+}
+
+Vector MobilityTrace::GetPosicionInicial(uint32_t nodo) const {
+  const PuntoRecorrido & p = m_puntos[m_inicio[nodo]];
+  return Vector(p.x, p.y, 0);
+}
+
+bool MobilityTrace::GetOrigen(uint32_t & seed, uint64_t & run) const {
+  seed = m_seed;
+  run = m_run;
+  return m_conOrigen;
+}
+
+// Sumidero de trazas CSV: mantiene el archivo abierto durante toda la
+// simulación con un buffer grande en espacio de usuario, en lugar de abrir,
+// escribir con std::endl y cerrar el archivo por cada evento.
+class CsvTraceSink {
+  public:
+
+    CsvTraceSink();
+  ~CsvTraceSink();
+
+  bool Open(const std::string & fileName, std::size_t bufferSize = 1 << 20);
+  void WriteHeader();
+  void WriteRecord(double time, const char * trafficType, Ipv4Address ipSource,
+    Ipv4Address ipDest, int bytesSent);
+  void Flush();
+  void Close();
+
+  uint64_t GetBytesWritten(void) const;
+  uint64_t GetRecordsWritten(void) const;
+
+  private:
+    void Append(const char * data, std::size_t size);
+
+  std::ofstream m_out;
+  std::vector < char > m_buffer;
+  uint64_t m_bytesWritten;
+  uint64_t m_recordsWritten;
+};
+
+CsvTraceSink::CsvTraceSink(): m_bytesWritten(0),
+  m_recordsWritten(0) {}
+
+CsvTraceSink::~CsvTraceSink() {
+  Close();
+}
+
+bool CsvTraceSink::Open(const std::string & fileName, std::size_t bufferSize) {
+  Close();
+  // El buffer debe asignarse antes de abrir el archivo para que el
+  // filebuf lo use en lugar de su buffer interno (normalmente de 4-8 KiB)
+  m_buffer.resize(bufferSize);
+  m_out.rdbuf() -> pubsetbuf(m_buffer.data(), m_buffer.size());
+  m_out.open(fileName.c_str(), std::ios::out | std::ios::trunc);
+  m_bytesWritten = 0;
+  m_recordsWritten = 0;
+  return m_out.is_open();
+}
+
+void CsvTraceSink::WriteHeader() {
+  static const char header[] = "Time,Type,Source,Destination,Bytes_sent\n";
+  Append(header, sizeof(header) - 1);
+}
+
+void CsvTraceSink::WriteRecord(double time, const char * trafficType,
+  Ipv4Address ipSource, Ipv4Address ipDest, int bytesSent) {
+  // Se formatea la línea completa en la pila, sin std::stringstream ni
+  // conversiones de Ipv4Address a std::string. "%g" reproduce el formato
+  // por defecto de operator<< para double (6 cifras significativas).
+  uint32_t src = ipSource.Get();
+  uint32_t dst = ipDest.Get();
+  char line[128];
+  int len = std::snprintf(line, sizeof(line), "%g,%s,%u.%u.%u.%u,%u.%u.%u.%u,%d\n",
+    time, trafficType,
+    (src >> 24) & 0xff, (src >> 16) & 0xff, (src >> 8) & 0xff, src & 0xff,
+    (dst >> 24) & 0xff, (dst >> 16) & 0xff, (dst >> 8) & 0xff, dst & 0xff,
+    bytesSent);
+  if (len <= 0) {
+    return;
+  }
+  Append(line, std::min < std::size_t > (len, sizeof(line) - 1));
+  m_recordsWritten++;
+}
+
+void CsvTraceSink::Append(const char * data, std::size_t size) {
+  if (!m_out.is_open()) {
+    return;
+  }
+  m_out.write(data, size);
+  m_bytesWritten += size;
+}
+
+void CsvTraceSink::Flush() {
+  if (m_out.is_open()) {
+    m_out.flush();
+  }
+}
+
+void CsvTraceSink::Close() {
+  if (m_out.is_open()) {
+    m_out.flush();
+    m_out.close();
+  }
+}
+
+uint64_t CsvTraceSink::GetBytesWritten(void) const {
+  return m_bytesWritten;
+}
+
+uint64_t CsvTraceSink::GetRecordsWritten(void) const {
+  return m_recordsWritten;
+}
+
+// Sumidero de la traza binaria por columnas: acumula un bloque de
+// registros en memoria, columna por columna, y lo escribe completo. Al
+// cerrar se completa el número de registros en el encabezado.
+class BinaryTraceSink {
+  public:
+
+    BinaryTraceSink();
+  ~BinaryTraceSink();
+
+  bool Open(const std::string & fileName);
+  void WriteHeader(const ScenarioConfig & cfg);
+  void WriteRecord(double time, const char * trafficType, Ipv4Address ipSource,
+    Ipv4Address ipDest, int bytesSent);
+  void Flush();
+  void Close();
+
+  uint64_t GetBytesWritten(void) const;
+  uint64_t GetRecordsWritten(void) const;
+
+  private:
+    uint8_t IndiceTipo(const char * trafficType);
+  void EscribirBloque();
+
+  std::ofstream m_out;
+  BinaryTraceHeader m_header;
+  // Último tipo visto: los tipos son literales, así que casi siempre basta
+  // con comparar el puntero
+  const char * m_ultimoTipo;
+  uint8_t m_ultimoIndice;
+
+  std::vector < int64_t > m_tiempoNs;
+  std::vector < uint32_t > m_origen;
+  std::vector < uint32_t > m_destino;
+  std::vector < uint16_t > m_bytes;
+  std::vector < uint8_t > m_tipo;
+  uint64_t m_bytesWritten;
+  uint64_t m_recordsWritten;
+};
+
+BinaryTraceSink::BinaryTraceSink(): m_ultimoTipo(nullptr),
+  m_ultimoIndice(0),
+  m_bytesWritten(0),
+  m_recordsWritten(0) {
+  std::memset( & m_header, 0, sizeof(m_header));
+}
+
+BinaryTraceSink::~BinaryTraceSink() {
+  Close();
+}
+
+bool BinaryTraceSink::Open(const std::string & fileName) {
+  Close();
+  m_out.open(fileName.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+  m_ultimoTipo = nullptr;
+  m_bytesWritten = 0;
+  m_recordsWritten = 0;
+  m_tiempoNs.reserve(TRAZA_REGISTROS_POR_BLOQUE);
+  m_origen.reserve(TRAZA_REGISTROS_POR_BLOQUE);
+  m_destino.reserve(TRAZA_REGISTROS_POR_BLOQUE);
+  m_bytes.reserve(TRAZA_REGISTROS_POR_BLOQUE);
+  m_tipo.reserve(TRAZA_REGISTROS_POR_BLOQUE);
+  return m_out.is_open();
+}
+
+void BinaryTraceSink::WriteHeader(const ScenarioConfig & cfg) {
+  // Metadatos de la corrida; el número de registros se completa al cerrar.
+  // Los tipos conocidos van fijos desde el inicio para que una traza cortada
+  // antes de Close siga siendo legible
+  static const char * const TIPOS_CONOCIDOS[] = {"request", "retry", "reply"};
+  std::memset( & m_header, 0, sizeof(m_header));
+  for (const char * tipo: TIPOS_CONOCIDOS) {
+    std::strncpy(m_header.tipos[m_header.numTipos++], tipo, TRAZA_LARGO_NOMBRE - 1);
+  }
+  std::memcpy(m_header.magic, TRAZA_MAGIC, sizeof(m_header.magic));
+  m_header.version = TRAZA_VERSION;
+  m_header.headerSize = sizeof(BinaryTraceHeader);
+  m_header.blockCapacity = TRAZA_REGISTROS_POR_BLOQUE;
+  m_header.seed = RngSeedManager::GetSeed();
+  m_header.run = RngSeedManager::GetRun();
+  m_header.numNotificadores = cfg.numNotificadores;
+  m_header.numRescatistas = cfg.numRescatistas;
+  m_header.numCentrales = cfg.numCentrales;
+  m_header.simulationTime = cfg.simulationTime;
+  std::strncpy(m_header.protocolo, cfg.routingProtocol.c_str(), TRAZA_LARGO_NOMBRE - 1);
+  if (!m_out.is_open()) {
+    return;
+  }
+  m_out.write(reinterpret_cast < const char * > ( & m_header), sizeof(m_header));
+  m_bytesWritten += sizeof(m_header);
+}
+
+uint8_t BinaryTraceSink::IndiceTipo(const char * trafficType) {
+  if (trafficType == m_ultimoTipo) {
+    return m_ultimoIndice;
+  }
+  uint32_t i = 0;
+  while (i < m_header.numTipos && std::strncmp(m_header.tipos[i], trafficType, TRAZA_LARGO_NOMBRE) != 0) {
+    i++;
+  }
+  if (i == m_header.numTipos) {
+    if (i == TRAZA_MAX_TIPOS) {
+      NS_FATAL_ERROR("Demasiados tipos de registro para la traza binaria: " << trafficType);
+    }
+    std::strncpy(m_header.tipos[i], trafficType, TRAZA_LARGO_NOMBRE - 1);
+    m_header.numTipos++;
+  }
+  m_ultimoTipo = trafficType;
+  m_ultimoIndice = static_cast < uint8_t > (i);
+  return m_ultimoIndice;
+}
+
+void BinaryTraceSink::WriteRecord(double time, const char * trafficType,
+  Ipv4Address ipSource, Ipv4Address ipDest, int bytesSent) {
+  if (!m_out.is_open()) {
+    return;
+  }
+  m_tiempoNs.push_back(std::llround(time * 1e9));
+  m_origen.push_back(ipSource.Get());
+  m_destino.push_back(ipDest.Get());
+  m_bytes.push_back(static_cast < uint16_t > (std::min(std::max(bytesSent, 0), 0xffff)));
+  m_tipo.push_back(IndiceTipo(trafficType));
+  m_recordsWritten++;
+  if (m_tiempoNs.size() == TRAZA_REGISTROS_POR_BLOQUE) {
+    EscribirBloque();
+  }
+}
+
+void BinaryTraceSink::EscribirBloque() {
+  uint32_t n = m_tiempoNs.size();
+  if (n == 0) {
+    return;
+  }
+  BinaryTraceBlockHeader bh;
+  bh.numRegistros = n;
+  bh.bytes = TamanoBloqueTraza(n);
+  m_out.write(reinterpret_cast < const char * > ( & bh), sizeof(bh));
+  m_out.write(reinterpret_cast < const char * > (m_tiempoNs.data()), n * sizeof(int64_t));
+  m_out.write(reinterpret_cast < const char * > (m_origen.data()), n * sizeof(uint32_t));
+  m_out.write(reinterpret_cast < const char * > (m_destino.data()), n * sizeof(uint32_t));
+  m_out.write(reinterpret_cast < const char * > (m_bytes.data()), n * sizeof(uint16_t));
+  m_out.write(reinterpret_cast < const char * > (m_tipo.data()), n * sizeof(uint8_t));
+  // Relleno hasta múltiplo de 8 bytes para que el bloque siguiente quede alineado
+  static const char relleno[8] = {};
+  std::size_t escritos = sizeof(bh) + n * (sizeof(int64_t) + 2 * sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t));
+  m_out.write(relleno, bh.bytes - escritos);
+  m_bytesWritten += bh.bytes;
+
+  m_tiempoNs.clear();
+  m_origen.clear();
+  m_destino.clear();
+  m_bytes.clear();
+  m_tipo.clear();
+}
+
+void BinaryTraceSink::Flush() {
+  if (m_out.is_open()) {
+    // Un bloque parcial es válido: cada bloque lleva su propio tamaño
+    EscribirBloque();
+    m_out.flush();
+  }
+}
+
+void BinaryTraceSink::Close() {
+  if (!m_out.is_open()) {
+    return;
+  }
+  EscribirBloque();
+  // Reescribir el encabezado con el total de registros y los tipos extra
+  m_header.numRegistros = m_recordsWritten;
+  m_out.seekp(0);
+  m_out.write(reinterpret_cast < const char * > ( & m_header), sizeof(m_header));
+  m_out.close();
+}
+
+uint64_t BinaryTraceSink::GetBytesWritten(void) const {
+  return m_bytesWritten;
+}
+
+uint64_t BinaryTraceSink::GetRecordsWritten(void) const {
+  return m_recordsWritten;
+}
+
+CsvTraceSink traceSink;
+BinaryTraceSink binaryTraceSink;
+
+// Función para escribir en el archivo de trazas (CSV o binario)
+void
+WriteCSVFile(double time, const char * trafficType, Ipv4Address ipSource,
+  Ipv4Address ipDest, int bytesSent) {
+  if (trazaBinaria) {
+    binaryTraceSink.WriteRecord(time, trafficType, ipSource, ipDest, bytesSent);
+    return;
+  }
+  traceSink.WriteRecord(time, trafficType, ipSource, ipDest, bytesSent);
+}
+
+// Registro estructurado de eventos de la aplicación para depurar corridas
+// grandes: una línea JSON por evento. Cada tipo de evento tiene un cubo de
+// fichas en tiempo simulado (tasa por segundo y ráfaga máxima), así una
+// corrida de miles de nodos no llena el disco; los eventos descartados se
+// cuentan y se resumen al cerrar.
+enum TipoEvento {
+  EVENTO_SOLICITUD = 0,
+  EVENTO_REINTENTO,
+  EVENTO_ASIGNACION,
+  EVENTO_RESPUESTA,
+  EVENTO_ABANDONO,
+  EVENTO_ERROR_ENVIO,
+  NUM_TIPOS_EVENTO
+};
+
+class EventLog {
+  public:
+
+    EventLog();
+  ~EventLog();
+
+  bool Open(const std::string & fileName, double tasa, double rafaga);
+  bool IsEnabled(void) const;
+  void Registrar(TipoEvento tipo, uint32_t idSolicitud, Ipv4Address origen, Ipv4Address destino);
+  void Close();
+
+  static const char * NombreEvento(uint32_t tipo);
+
+  private: bool Permitir(TipoEvento tipo, double ahora);
+
+  std::ofstream m_out;
+  std::vector < char > m_buffer;
+  double m_tasa;
+  double m_rafaga;
+  double m_fichas[NUM_TIPOS_EVENTO];
+  double m_ultimo[NUM_TIPOS_EVENTO];
+  uint64_t m_escritos[NUM_TIPOS_EVENTO];
+  uint64_t m_suprimidos[NUM_TIPOS_EVENTO];
+};
+
+EventLog::EventLog(): m_tasa(0),
+  m_rafaga(0) {}
+
+EventLog::~EventLog() {
+  Close();
+}
+
+bool EventLog::Open(const std::string & fileName, double tasa, double rafaga) {
+  Close();
+  m_buffer.resize(1 << 16);
+  m_out.rdbuf() -> pubsetbuf(m_buffer.data(), m_buffer.size());
+  m_out.open(fileName.c_str(), std::ios::out | std::ios::trunc);
+  m_tasa = tasa;
+  m_rafaga = std::max(rafaga, 1.0);
+  for (uint32_t i = 0; i < NUM_TIPOS_EVENTO; i++) {
+    m_fichas[i] = m_rafaga;
+    m_ultimo[i] = 0;
+    m_escritos[i] = 0;
+    m_suprimidos[i] = 0;
+  }
+  return m_out.is_open();
+}
+
+bool EventLog::IsEnabled(void) const {
+  return m_out.is_open();
+}
+
+const char * EventLog::NombreEvento(uint32_t tipo) {
+  static const char * nombres[NUM_TIPOS_EVENTO] = {
+    "solicitud",
+    "reintento",
+    "asignacion",
+    "respuesta",
+    "abandono",
+    "error_envio"
+  };
+  return nombres[tipo];
+}
+
+bool EventLog::Permitir(TipoEvento tipo, double ahora) {
+  m_fichas[tipo] = std::min(m_rafaga, m_fichas[tipo] + (ahora - m_ultimo[tipo]) * m_tasa);
+  m_ultimo[tipo] = ahora;
+  if (m_fichas[tipo] < 1) {
+    m_suprimidos[tipo]++;
+    return false;
+  }
+  m_fichas[tipo] -= 1;
+  return true;
+}
+
+void EventLog::Registrar(TipoEvento tipo, uint32_t idSolicitud, Ipv4Address origen, Ipv4Address destino) {
+  if (!m_out.is_open()) {
+    return;
+  }
+  double ahora = Simulator::Now().GetSeconds();
+  if (!Permitir(tipo, ahora)) {
+    return;
+  }
+  uint32_t src = origen.Get();
+  uint32_t dst = destino.Get();
+  char linea[192];
+  int len = std::snprintf(linea, sizeof(linea),
+    "{\"t\":%.9g,\"evento\":\"%s\",\"id\":%u,\"origen\":\"%u.%u.%u.%u\",\"destino\":\"%u.%u.%u.%u\"}\n",
+    ahora, NombreEvento(tipo), idSolicitud,
+    (src >> 24) & 0xff, (src >> 16) & 0xff, (src >> 8) & 0xff, src & 0xff,
+    (dst >> 24) & 0xff, (dst >> 16) & 0xff, (dst >> 8) & 0xff, dst & 0xff);
+  if (len > 0) {
+    m_out.write(linea, std::min < std::size_t > (len, sizeof(linea) - 1));
+    m_escritos[tipo]++;
+  }
+}
+
+void EventLog::Close() {
+  if (!m_out.is_open()) {
+    return;
+  }
+  // Resumen por tipo con los eventos escritos y los descartados por la tasa
+  for (uint32_t i = 0; i < NUM_TIPOS_EVENTO; i++) {
+    m_out << "{\"evento\":\"resumen\",\"tipo\":\"" << NombreEvento(i) << "\",\"escritos\":" <<
+      m_escritos[i] << ",\"suprimidos\":" << m_suprimidos[i] << "}\n";
+  }
+  m_out.close();
+}
+
+EventLog eventLog;
+
+// Estimador P² (Jain y Chlamtac, 1985) de un cuantil: mantiene cinco
+// marcadores y ajusta sus alturas con interpolación parabólica, por lo que
+// usa memoria constante sin importar el número de observaciones.
+class P2Quantile {
+  public:
+
+    explicit P2Quantile(double p);
+
+  void Add(double x);
+  double Get(void) const;
+  uint64_t GetCount(void) const;
+
+  private:
+    double Parabolic(int i, double d) const;
+  double Linear(int i, int d) const;
+
+  double m_p;
+  uint64_t m_count;
+  double m_q[5]; // alturas de los marcadores
+  double m_n[5]; // posiciones actuales
+  double m_np[5]; // posiciones deseadas
+  double m_dn[5]; // incremento de las posiciones deseadas
+};
+
+P2Quantile::P2Quantile(double p): m_p(p),
+  m_count(0) {
+  m_dn[0] = 0;
+  m_dn[1] = p / 2;
+  m_dn[2] = p;
+  m_dn[3] = (1 + p) / 2;
+  m_dn[4] = 1;
+  for (int i = 0; i < 5; i++) {
+    m_q[i] = 0;
+    m_n[i] = i + 1;
+  }
+  m_np[0] = 1;
+  m_np[1] = 1 + 2 * p;
+  m_np[2] = 1 + 4 * p;
+  m_np[3] = 3 + 2 * p;
+  m_np[4] = 5;
+}
+
+void P2Quantile::Add(double x) {
+  if (m_count < 5) {
+    // Las primeras cinco observaciones se guardan ordenadas
+    m_q[m_count++] = x;
+    std::sort(m_q, m_q + m_count);
+    return;
+  }
+  m_count++;
+
+  int k;
+  if (x < m_q[0]) {
+    m_q[0] = x;
+    k = 0;
+  } else if (x >= m_q[4]) {
+    m_q[4] = x;
+    k = 3;
+  } else {
+    k = 0;
+    while (k < 3 && x >= m_q[k + 1]) {
+      k++;
+    }
+  }
+
+  for (int i = k + 1; i < 5; i++) {
+    m_n[i] += 1;
+  }
+  for (int i = 0; i < 5; i++) {
+    m_np[i] += m_dn[i];
+  }
+
+  // Ajustar los marcadores centrales si se alejaron de su posición deseada
+  for (int i = 1; i < 4; i++) {
+    double d = m_np[i] - m_n[i];
+    if ((d >= 1 && m_n[i + 1] - m_n[i] > 1) || (d <= -1 && m_n[i - 1] - m_n[i] < -1)) {
+      int ds = d > 0 ? 1 : -1;
+      double q = Parabolic(i, ds);
+      if (m_q[i - 1] < q && q < m_q[i + 1]) {
+        m_q[i] = q;
+      } else {
+        m_q[i] = Linear(i, ds);
+      }
+      m_n[i] += ds;
+    }
+  }
+}
+
+double P2Quantile::Parabolic(int i, double d) const {
+  return m_q[i] + d / (m_n[i + 1] - m_n[i - 1]) *
+    ((m_n[i] - m_n[i - 1] + d) * (m_q[i + 1] - m_q[i]) / (m_n[i + 1] - m_n[i]) +
+      (m_n[i + 1] - m_n[i] - d) * (m_q[i] - m_q[i - 1]) / (m_n[i] - m_n[i - 1]));
+}
+
+double P2Quantile::Linear(int i, int d) const {
+  return m_q[i] + d * (m_q[i + d] - m_q[i]) / (m_n[i + d] - m_n[i]);
+}
+
+double P2Quantile::Get(void) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  if (m_count <= 5) {
+    // Con pocas observaciones el cuantil es exacto (interpolación lineal,
+    // igual que pandas)
+    double pos = m_p * (m_count - 1);
+    std::size_t lo = static_cast < std::size_t > (pos);
+    std::size_t hi = std::min < std::size_t > (lo + 1, m_count - 1);
+    return m_q[lo] + (pos - lo) * (m_q[hi] - m_q[lo]);
+  }
+  return m_q[2];
+}
+
+uint64_t P2Quantile::GetCount(void) const {
+  return m_count;
+}
+
+// Estadísticas en línea de los tiempos de respuesta. Cada solicitud se
+// registra por su identificador al enviarse y se empareja con su respuesta
+// exacta, así dos solicitudes simultáneas de un mismo notificador no se
+// confunden. Media y varianza se calculan con Welford y los percentiles
+// con P², de modo que la memoria sólo depende de las solicitudes en curso.
+class ResponseTimeStats {
+  public:
+
+    ResponseTimeStats();
+
+  void RegistrarSolicitud(uint32_t id, Time enviado);
+  bool RegistrarRespuesta(uint32_t id, Time recibido);
+  void RegistrarPerdida(uint32_t id);
+  void RegistrarEvento(Time t);
+
+  uint64_t GetSolicitudes(void) const;
+  uint64_t GetRespuestas(void) const;
+  uint64_t GetPendientes(void) const;
+  double GetMedia(void) const;
+  double GetVarianza(void) const;
+  double GetDesviacion(void) const;
+  double GetMinimo(void) const;
+  double GetMaximo(void) const;
+  double GetPercentil(double p) const;
+  double GetTiempoUltimoEvento(void) const;
+
+  void WriteIndicadores(const std::string & fileName, const std::string & protocolo) const;
+
+  private:
+    std::unordered_map < uint32_t, Time > m_pendientes;
+  uint64_t m_solicitudes;
+  uint64_t m_respuestas;
+  double m_media;
+  double m_m2;
+  double m_minimo;
+  double m_maximo;
+  double m_ultimoEvento;
+  P2Quantile m_p50;
+  P2Quantile m_p95;
+  P2Quantile m_p99;
+};
+
+ResponseTimeStats::ResponseTimeStats(): m_solicitudes(0),
+  m_respuestas(0),
+  m_media(0),
+  m_m2(0),
+  m_minimo(0),
+  m_maximo(0),
+  m_ultimoEvento(0),
+  m_p50(0.50),
+  m_p95(0.95),
+  m_p99(0.99) {}
+
+void ResponseTimeStats::RegistrarSolicitud(uint32_t id, Time enviado) {
+  m_pendientes[id] = enviado;
+  m_solicitudes++;
+  RegistrarEvento(enviado);
+}
+
+bool ResponseTimeStats::RegistrarRespuesta(uint32_t id, Time recibido) {
+  auto it = m_pendientes.find(id);
+  if (it == m_pendientes.end()) {
+    // Respuesta duplicada o de una solicitud no registrada
+    return false;
+  }
+  double x = (recibido - it -> second).GetSeconds();
+  m_pendientes.erase(it);
+  RegistrarEvento(recibido);
+
+  m_respuestas++;
+  if (m_respuestas == 1) {
+    m_minimo = m_maximo = x;
+  } else {
+    m_minimo = std::min(m_minimo, x);
+    m_maximo = std::max(m_maximo, x);
+  }
+  double delta = x - m_media;
+  m_media += delta / m_respuestas;
+  m_m2 += delta * (x - m_media);
+  m_p50.Add(x);
+  m_p95.Add(x);
+  m_p99.Add(x);
+  return true;
+}
+
+void ResponseTimeStats::RegistrarPerdida(uint32_t id) {
+  // La solicitud se dio por perdida: una respuesta tardía ya no cuenta
+  m_pendientes.erase(id);
+}
+
+void ResponseTimeStats::RegistrarEvento(Time t) {
+  m_ultimoEvento = std::max(m_ultimoEvento, t.GetSeconds());
+}
+
+uint64_t ResponseTimeStats::GetSolicitudes(void) const {
+  return m_solicitudes;
+}
+
+uint64_t ResponseTimeStats::GetRespuestas(void) const {
+  return m_respuestas;
+}
+
+uint64_t ResponseTimeStats::GetPendientes(void) const {
+  return m_pendientes.size();
+}
+
+double ResponseTimeStats::GetMedia(void) const {
+  return m_media;
+}
+
+double ResponseTimeStats::GetVarianza(void) const {
+  // Varianza muestral (n - 1), igual que pandas
+  return m_respuestas > 1 ? m_m2 / (m_respuestas - 1) : 0;
+}
+
+double ResponseTimeStats::GetDesviacion(void) const {
+  return std::sqrt(GetVarianza());
+}
+
+double ResponseTimeStats::GetMinimo(void) const {
+  return m_minimo;
+}
+
+double ResponseTimeStats::GetMaximo(void) const {
+  return m_maximo;
+}
+
+double ResponseTimeStats::GetPercentil(double p) const {
+  if (p == 0.50) {
+    return m_p50.Get();
+  } else if (p == 0.95) {
+    return m_p95.Get();
+  } else if (p == 0.99) {
+    return m_p99.Get();
+  }
+  NS_FATAL_ERROR("Percentil no calculado: " << p);
+  return 0;
+}
+
+double ResponseTimeStats::GetTiempoUltimoEvento(void) const {
+  return m_ultimoEvento;
+}
+
+// Escribe el archivo de indicadores con las mismas columnas que genera
+// dataProcessing.py en results/indicadores.csv, más los percentiles 95 y 99
+void ResponseTimeStats::WriteIndicadores(const std::string & fileName,
+  const std::string & protocolo) const {
+  std::ofstream out(fileName.c_str(), std::ios::out | std::ios::trunc);
+  if (!out.is_open()) {
+    NS_LOG_ERROR("No se pudo abrir el archivo de indicadores: " << fileName);
+    return;
+  }
+  uint64_t perdidas = m_solicitudes - m_respuestas;
+  double total = m_solicitudes > 0 ? static_cast < double > (m_solicitudes) : 1;
+  // Redondeo a 4 decimales como en dataProcessing.py
+  auto r4 = [](double v) {
+    return std::round(v * 10000) / 10000;
+  };
+  out << "Protocolo," <<
+    "Llamadas efectivas," <<
+    "Porcentaje de llamadas efectivas," <<
+    "Llamadas perdidas," <<
+    "Porcentaje de llamadas perdidas," <<
+    "Llamadas realizadas," <<
+    "Tiempo total de simulacion (s)," <<
+    "Tiempo de respuesta promedio (s)," <<
+    "Tiempo de respuesta maximo (s)," <<
+    "Tiempo de respuesta minimo (s)," <<
+    "Tiempo de respuesta - mediana (s)," <<
+    "Tiempo de respuesta - desviacion estandar," <<
+    "Tiempo de respuesta - varianza," <<
+    "Tiempo de respuesta - p95 (s)," <<
+    "Tiempo de respuesta - p99 (s)\n";
+  out << protocolo << "," <<
+    m_respuestas << "," <<
+    "%" << r4(m_respuestas / total * 100) << "," <<
+    perdidas << "," <<
+    "%" << r4(perdidas / total * 100) << "," <<
+    m_solicitudes << "," <<
+    r4(m_ultimoEvento) << "," <<
+    r4(m_media) << "," <<
+    r4(m_maximo) << "," <<
+    r4(m_minimo) << "," <<
+    r4(m_p50.Get()) << "," <<
+    r4(GetDesviacion()) << "," <<
+    r4(GetVarianza()) << "," <<
+    r4(m_p95.Get()) << "," <<
+    r4(m_p99.Get()) << "\n";
+}
+
+// Histograma de latencias con intervalos en escala logarítmica (20 por
+// década entre 1 µs y 1000 s), más conteo, suma, mínimo y máximo exactos.
+// Los percentiles se estiman con el límite superior del intervalo.
+class LatencyHistogram {
+  public:
+
+    LatencyHistogram();
+
+  void Add(double segundos);
+  uint64_t GetCount(void) const;
+  double GetMedia(void) const;
+  double GetMaximo(void) const;
+  double GetPercentil(double p) const;
+
+  // Límites del intervalo i en segundos
+  static double LimiteInferior(uint32_t i);
+  static double LimiteSuperior(uint32_t i);
+
+  static const uint32_t POR_DECADA = 20;
+  static const int DECADA_MINIMA = -6;
+  static const uint32_t NUM_INTERVALOS = 9 * POR_DECADA + 2;
+
+  const std::vector < uint64_t > & GetConteos(void) const;
+
+  private: std::vector < uint64_t > m_conteos;
+  uint64_t m_count;
+  double m_suma;
+  double m_maximo;
+};
+
+LatencyHistogram::LatencyHistogram(): m_conteos(NUM_INTERVALOS, 0),
+  m_count(0),
+  m_suma(0),
+  m_maximo(0) {}
+
+void LatencyHistogram::Add(double segundos) {
+  // El intervalo 0 recoge lo menor a 1 µs y el último lo mayor a 1000 s
+  uint32_t i = 0;
+  if (segundos > 0) {
+    double pos = (std::log10(segundos) - DECADA_MINIMA) * POR_DECADA;
+    if (pos >= 0) {
+      i = std::min < uint32_t > (NUM_INTERVALOS - 1, static_cast < uint32_t > (pos) + 1);
+    }
+  }
+  m_conteos[i]++;
+  m_count++;
+  m_suma += segundos;
+  m_maximo = std::max(m_maximo, segundos);
+}
+
+uint64_t LatencyHistogram::GetCount(void) const {
+  return m_count;
+}
+
+double LatencyHistogram::GetMedia(void) const {
+  return m_count ? m_suma / m_count : 0;
+}
+
+double LatencyHistogram::GetMaximo(void) const {
+  return m_maximo;
+}
+
+double LatencyHistogram::LimiteInferior(uint32_t i) {
+  return i == 0 ? 0 : std::pow(10.0, DECADA_MINIMA + (i - 1.0) / POR_DECADA);
+}
+
+double LatencyHistogram::LimiteSuperior(uint32_t i) {
+  return i == NUM_INTERVALOS - 1 ? std::numeric_limits < double > ::infinity() :
+    std::pow(10.0, DECADA_MINIMA + static_cast < double > (i) / POR_DECADA);
+}
+
+double LatencyHistogram::GetPercentil(double p) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  uint64_t objetivo = static_cast < uint64_t > (std::ceil(p * m_count));
+  uint64_t acumulado = 0;
+  for (uint32_t i = 0; i < NUM_INTERVALOS; i++) {
+    acumulado += m_conteos[i];
+    if (acumulado >= objetivo) {
+      return std::min(LimiteSuperior(i), m_maximo);
+    }
+  }
+  return m_maximo;
+}
+
+const std::vector < uint64_t > & LatencyHistogram::GetConteos(void) const {
+  return m_conteos;
+}
+
+// Latencia de cada tramo del recorrido de una solicitud, a partir de los
+// EtapaTag: notificador -> central, central -> rescatista,
+// rescatista -> central y central -> notificador
+class LegLatencyStats {
+  public:
+
+    LegLatencyStats();
+
+  void Registrar(Ptr < const Packet > packet, Time recibido);
+  void Print(std::ostream & os) const;
+  void WriteCsv(const std::string & fileName) const;
+
+  static const char * NombreTramo(uint32_t tramo);
+
+  private: LatencyHistogram m_tramos[NUM_ETAPAS];
+  uint64_t m_incompletas;
+};
+
+LegLatencyStats::LegLatencyStats(): m_incompletas(0) {}
+
+const char * LegLatencyStats::NombreTramo(uint32_t tramo) {
+  static const char * nombres[NUM_ETAPAS] = {
+    "notificador->central",
+    "central->rescatista",
+    "rescatista->central",
+    "central->notificador"
+  };
+  return nombres[tramo];
+}
+
+void LegLatencyStats::Registrar(Ptr < const Packet > packet, Time recibido) {
+  // Instantes de cada etapa; la última es la llegada al notificador
+  int64_t tiempos[NUM_ETAPAS + 1];
+  bool presentes[NUM_ETAPAS + 1] = {};
+  ByteTagIterator it = packet -> GetByteTagIterator();
+  while (it.HasNext()) {
+    ByteTagIterator::Item item = it.Next();
+    if (item.GetTypeId() != EtapaTag::GetTypeId()) {
+      continue;
+    }
+    EtapaTag tag;
+    item.GetTag(tag);
+    if (tag.GetEtapa() < NUM_ETAPAS) {
+      tiempos[tag.GetEtapa()] = tag.GetTiempo().GetTimeStep();
+      presentes[tag.GetEtapa()] = true;
+    }
+  }
+  tiempos[NUM_ETAPAS] = recibido.GetTimeStep();
+  presentes[NUM_ETAPAS] = true;
+
+  for (uint32_t e = 0; e < NUM_ETAPAS; e++) {
+    if (!presentes[e]) {
+      m_incompletas++;
+      return;
+    }
+  }
+  for (uint32_t e = 0; e < NUM_ETAPAS; e++) {
+    m_tramos[e].Add(TimeStep(tiempos[e + 1] - tiempos[e]).GetSeconds());
+  }
+}
+
+void LegLatencyStats::Print(std::ostream & os) const {
+  os << "Latencia por tramo (s):\n";
+  for (uint32_t e = 0; e < NUM_ETAPAS; e++) {
+    const LatencyHistogram & h = m_tramos[e];
+    os << "  " << NombreTramo(e) << ": n " << h.GetCount() <<
+      ", promedio " << h.GetMedia() <<
+      ", p50 " << h.GetPercentil(0.50) <<
+      ", p95 " << h.GetPercentil(0.95) <<
+      ", p99 " << h.GetPercentil(0.99) <<
+      ", máximo " << h.GetMaximo() << "\n";
+  }
+  if (m_incompletas > 0) {
+    os << "  Respuestas sin todas las etapas: " << m_incompletas << "\n";
+  }
+}
+
+void LegLatencyStats::WriteCsv(const std::string & fileName) const {
+  std::ofstream out(fileName.c_str(), std::ios::out | std::ios::trunc);
+  if (!out.is_open()) {
+    NS_LOG_ERROR("No se pudo abrir el archivo de latencias: " << fileName);
+    return;
+  }
+  // Sólo se escriben los intervalos con observaciones
+  out << "Tramo,Limite inferior (s),Limite superior (s),Conteo\n";
+  for (uint32_t e = 0; e < NUM_ETAPAS; e++) {
+    const std::vector < uint64_t > & conteos = m_tramos[e].GetConteos();
+    for (uint32_t i = 0; i < conteos.size(); i++) {
+      if (conteos[i] > 0) {
+        out << NombreTramo(e) << "," << LatencyHistogram::LimiteInferior(i) << "," <<
+          LatencyHistogram::LimiteSuperior(i) << "," << conteos[i] << "\n";
+      }
+    }
+  }
+}
+
+// Rol de cada nodo dentro del escenario
+enum RolNodo {
+  ROL_NOTIFICADOR = 0,
+  ROL_RESCATISTA = 1,
+  ROL_CENTRAL = 2,
+  ROL_DESCONOCIDO = 3
+};
+
+// Índice de direcciones IP: se construye una sola vez después de
+// address.Assign(allDevices) y permite consultas O(1) de dirección a nodo,
+// rol e índice local dentro del rol, y de (rol, índice) a dirección.
+class IpNodeIndex {
+  public:
+    struct Entrada {
+      Ptr < Node > node;
+      RolNodo rol;
+      uint32_t indiceLocal;
+    };
+
+  void Clear();
+  void Add(const NodeContainer & nodes, RolNodo rol);
+
+  const Entrada * Lookup(Ipv4Address ip) const;
+  Ptr < Node > GetNode(Ipv4Address ip) const;
+  Ipv4Address GetAddress(RolNodo rol, uint32_t indiceLocal) const;
+  uint32_t GetN(RolNodo rol) const;
+
+  private:
+    std::unordered_map < uint32_t, Entrada > m_porIp;
+  std::vector < Ipv4Address > m_porRol[ROL_DESCONOCIDO];
+};
+
+void IpNodeIndex::Clear() {
+  m_porIp.clear();
+  for (auto & direcciones: m_porRol) {
+    direcciones.clear();
+  }
+}
+
+void IpNodeIndex::Add(const NodeContainer & nodes, RolNodo rol) {
+  NS_ASSERT(rol < ROL_DESCONOCIDO);
+  m_porIp.reserve(m_porIp.size() + nodes.GetN());
+  m_porRol[rol].reserve(m_porRol[rol].size() + nodes.GetN());
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr < Node > node = nodes.Get(i);
+    // La interfaz 0 es la de bucle invertido, la 1 es la wifi
+    Ipv4Address ip = node -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal();
+    Entrada entrada;
+    entrada.node = node;
+    entrada.rol = rol;
+    entrada.indiceLocal = static_cast < uint32_t > (m_porRol[rol].size());
+    m_porIp[ip.Get()] = entrada;
+    m_porRol[rol].push_back(ip);
+  }
+}
+
+const IpNodeIndex::Entrada * IpNodeIndex::Lookup(Ipv4Address ip) const {
+  auto it = m_porIp.find(ip.Get());
+  if (it == m_porIp.end()) {
+    return nullptr;
+  }
+  return & it -> second;
+}
+
+Ptr < Node > IpNodeIndex::GetNode(Ipv4Address ip) const {
+  const Entrada * entrada = Lookup(ip);
+  return entrada ? entrada -> node : nullptr;
+}
+
+Ipv4Address IpNodeIndex::GetAddress(RolNodo rol, uint32_t indiceLocal) const {
+  NS_ASSERT(rol < ROL_DESCONOCIDO && indiceLocal < m_porRol[rol].size());
+  return m_porRol[rol][indiceLocal];
+}
+
+uint32_t IpNodeIndex::GetN(RolNodo rol) const {
+  return rol < ROL_DESCONOCIDO ? m_porRol[rol].size() : 0;
+}
+
+// Pool de sockets UDP conectados, uno por (nodo origen, destino, puerto).
+// Los sockets se crean la primera vez que se necesitan y se reutilizan el
+// resto de la simulación, en lugar de crear, conectar y cerrar un socket
+// por cada paquete reenviado.
+class SocketPool {
+  public:
+
+    SocketPool();
+
+  Ptr < Socket > Get(Ptr < Node > node, Ipv4Address dstAddr, uint16_t port);
+  void Clear();
+
+  uint64_t GetHits(void) const;
+  uint64_t GetMisses(void) const;
+  std::size_t GetSize(void) const;
+
+  private:
+    struct Clave {
+      uint32_t nodeId;
+      uint32_t ip;
+      uint16_t port;
+      bool operator == (const Clave & o) const {
+        return nodeId == o.nodeId && ip == o.ip && port == o.port;
+      }
+    };
+  struct ClaveHash {
+    std::size_t operator()(const Clave & c) const {
+      uint64_t h = (static_cast < uint64_t > (c.nodeId) << 32) ^ c.ip;
+      h ^= static_cast < uint64_t > (c.port) << 48;
+      return std::hash < uint64_t > ()(h);
+    }
+  };
+
+  TypeId m_tid;
+  std::unordered_map < Clave, Ptr < Socket > , ClaveHash > m_sockets;
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+SocketPool::SocketPool(): m_hits(0),
+  m_misses(0) {}
+
+Ptr < Socket > SocketPool::Get(Ptr < Node > node, Ipv4Address dstAddr, uint16_t port) {
+  Clave clave = {
+    node -> GetId(),
+    dstAddr.Get(),
+    port
+  };
+  auto it = m_sockets.find(clave);
+  if (it != m_sockets.end()) {
+    m_hits++;
+    return it -> second;
+  }
+  m_misses++;
+  if (m_tid == TypeId()) {
+    // Se busca el TypeId una sola vez
+    m_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+  }
+  Ptr < Socket > source = Socket::CreateSocket(node, m_tid);
+  source -> Connect(InetSocketAddress(dstAddr, port));
+  m_sockets.emplace(clave, source);
+  return source;
+}
+
+void SocketPool::Clear() {
+  for (auto & entrada: m_sockets) {
+    entrada.second -> Close();
+  }
+  m_sockets.clear();
+}
+
+uint64_t SocketPool::GetHits(void) const {
+  return m_hits;
+}
+
+uint64_t SocketPool::GetMisses(void) const {
+  return m_misses;
+}
+
+std::size_t SocketPool::GetSize(void) const {
+  return m_sockets.size();
+}
+
+// Puertos de los centrales: las solicitudes de los notificadores llegan al
+// puerto de solicitudes y las respuestas de los rescatistas al de respuestas
+const uint16_t PUERTO_SOLICITUDES = 80;
+const uint16_t PUERTO_RESPUESTAS = 81;
+
+// Puertos de rescatistas y notificadores: los mensajes que reenvían los
+// centrales llegan uno a uno al de entregas y agregados al de agregados
+const uint16_t PUERTO_ENTREGAS = 80;
+const uint16_t PUERTO_AGREGADOS = 82;
+
+// Agregación de mensajes en los centrales. En lugar de reenviar cada
+// solicitud o respuesta en su propio datagrama, el central guarda los
+// mensajes hacia un mismo destino hasta que pasa el retardo máximo desde
+// el primero o se llena el presupuesto de bytes, y los envía en un solo
+// paquete con un RescueAggregateHeader. Un mensaje que sale solo se envía
+// tal cual al puerto de siempre.
+class MessageAggregator {
+  public:
+
+    MessageAggregator();
+
+  void Configurar(Time retardo, uint32_t maxBytes, SocketPool * pool);
+  bool IsActivo(void) const;
+  // El mensaje lleva su RescueHeader al frente, como si se enviara solo
+  void Encolar(Ptr < Node > origen, Ipv4Address destino, uint16_t puerto, Ptr < Packet > mensaje);
+  void Clear(void);
+  void Print(std::ostream & os) const;
+
+  // Separa un paquete agregado en los mensajes originales
+  static void Desagregar(Ptr < Packet > agregado, std::vector < Ptr < Packet > > & mensajes);
+
+  private:
+    struct Cola {
+      Ptr < Node > origen;
+      Ipv4Address destino;
+      uint16_t puerto;
+      std::vector < Ptr < Packet > > mensajes;
+      uint32_t bytes;
+      Time primero;
+      EventId envio;
+    };
+
+  void Enviar(uint64_t clave);
+
+  Time m_retardo;
+  uint32_t m_maxBytes;
+  SocketPool * m_pool;
+  std::unordered_map < uint64_t, Cola > m_colas;
+
+  uint64_t m_mensajes;
+  uint64_t m_enviados;
+  uint64_t m_paquetes;
+  uint64_t m_agregados;
+  uint32_t m_maxPorPaquete;
+  Time m_esperaTotal;
+};
+
+MessageAggregator::MessageAggregator(): m_maxBytes(0),
+  m_pool(nullptr),
+  m_mensajes(0),
+  m_enviados(0),
+  m_paquetes(0),
+  m_agregados(0),
+  m_maxPorPaquete(0) {}
+
+void MessageAggregator::Configurar(Time retardo, uint32_t maxBytes, SocketPool * pool) {
+  m_retardo = retardo;
+  m_maxBytes = maxBytes;
+  m_pool = pool;
+  m_colas.clear();
+  m_mensajes = 0;
+  m_enviados = 0;
+  m_paquetes = 0;
+  m_agregados = 0;
+  m_maxPorPaquete = 0;
+  m_esperaTotal = Time(0);
+}
+
+bool MessageAggregator::IsActivo(void) const {
+  return m_retardo.IsStrictlyPositive();
+}
+
+void MessageAggregator::Encolar(Ptr < Node > origen, Ipv4Address destino, uint16_t puerto, Ptr < Packet > mensaje) {
+  // Una cola por par (central, destino)
+  uint64_t clave = (static_cast < uint64_t > (origen -> GetId()) << 32) | destino.Get();
+  Cola & cola = m_colas[clave];
+  uint32_t tamano = mensaje -> GetSize() - RescueHeader::SERIALIZED_SIZE + RescueAggregateHeader::TAMANO_POR_MENSAJE;
+  if (!cola.mensajes.empty() && cola.bytes + tamano > m_maxBytes) {
+    // El mensaje no cabe: sale lo acumulado y el mensaje abre un paquete nuevo
+    Enviar(clave);
+  }
+  if (cola.mensajes.empty()) {
+    cola.origen = origen;
+    cola.destino = destino;
+    cola.puerto = puerto;
+    cola.bytes = RescueAggregateHeader::TAMANO_FIJO;
+    cola.primero = Simulator::Now();
+    cola.envio = Simulator::Schedule(m_retardo, & MessageAggregator::Enviar, this, clave);
+  }
+  cola.mensajes.push_back(mensaje);
+  cola.bytes += tamano;
+  m_mensajes++;
+  if (cola.bytes >= m_maxBytes || cola.mensajes.size() == std::numeric_limits < uint16_t > ::max()) {
+    Enviar(clave);
+  }
+}
+
+void MessageAggregator::Enviar(uint64_t clave) {
+  auto it = m_colas.find(clave);
+  if (it == m_colas.end() || it -> second.mensajes.empty()) {
+    return;
+  }
+  Cola & cola = it -> second;
+  cola.envio.Cancel();
+  uint32_t n = cola.mensajes.size();
+  m_enviados += n;
+  m_paquetes++;
+  m_maxPorPaquete = std::max(m_maxPorPaquete, n);
+  m_esperaTotal += (Simulator::Now() - cola.primero) * n;
+
+  if (n == 1) {
+    m_pool -> Get(cola.origen, cola.destino, cola.puerto) -> Send(cola.mensajes.front());
+  } else {
+    m_agregados += n;
+    // Las cargas se concatenan sin copiarlas; los byte tags de cada una
+    // (EtapaTag) se conservan en el paquete agregado
+    Ptr < Packet > agregado = Create < Packet > ();
+    RescueAggregateHeader header;
+    for (Ptr < Packet > & mensaje: cola.mensajes) {
+      RescueHeader rescueHeader;
+      mensaje -> RemoveHeader(rescueHeader);
+      header.Agregar(rescueHeader, static_cast < uint16_t > (mensaje -> GetSize()));
+      agregado -> AddAtEnd(mensaje);
+    }
+    agregado -> AddHeader(header);
+    m_pool -> Get(cola.origen, cola.destino, PUERTO_AGREGADOS) -> Send(agregado);
+  }
+  cola.mensajes.clear();
+}
+
+void MessageAggregator::Desagregar(Ptr < Packet > agregado, std::vector < Ptr < Packet > > & mensajes) {
+  RescueAggregateHeader header;
+  agregado -> RemoveHeader(header);
+  uint32_t desplazamiento = 0;
+  for (uint16_t i = 0; i < header.GetN(); i++) {
+    uint32_t largo = header.GetLargoCarga(i);
+    NS_ABORT_MSG_IF(desplazamiento + largo > agregado -> GetSize(), "Paquete agregado truncado");
+    Ptr < Packet > mensaje = agregado -> CreateFragment(desplazamiento, largo);
+    mensaje -> AddHeader(header.GetSubHeader(i));
+    mensajes.push_back(mensaje);
+    desplazamiento += largo;
+  }
+}
+
+void MessageAggregator::Clear(void) {
+  for (auto & entrada: m_colas) {
+    entrada.second.envio.Cancel();
+  }
+  m_colas.clear();
+}
+
+void MessageAggregator::Print(std::ostream & os) const {
+  if (!IsActivo()) {
+    return;
+  }
+  os << "Agregación en centrales: " << m_enviados << " mensajes en " << m_paquetes << " paquetes (" <<
+    m_agregados << " agregados, " <<
+    (m_paquetes > 0 ? static_cast < double > (m_enviados) / m_paquetes : 0) <<
+    " por paquete, máximo " << m_maxPorPaquete << "), espera media " <<
+    (m_enviados > 0 ? m_esperaTotal.GetSeconds() / m_enviados * 1000 : 0) << " ms, " <<
+    m_mensajes - m_enviados << " en cola al terminar\n";
+}
+
+// Políticas para repartir las solicitudes entre los centrales
+enum PoliticaCentral {
+  CENTRAL_FIJA = 0, // central 0 recibe solicitudes y central 1 las respuestas
+  CENTRAL_HASH = 1, // hash consistente sobre la IP del notificador
+  CENTRAL_CERCANA = 2, // central más cercano al notificador
+  CENTRAL_MENOS_CARGADA = 3 // central con menos solicitudes pendientes
+};
+
+// Capa de reparto de solicitudes entre los centrales. Con la política fija
+// se conserva el comportamiento original (central 0 atiende solicitudes y
+// central 1 respuestas). Con las demás, cada solicitud se asigna a un
+// central y la respuesta del rescatista vuelve al mismo central, que la
+// entrega al notificador. Lleva la cola (backlog) de cada central: las
+// solicitudes que recibió y cuya respuesta aún no se entrega.
+class CentralDispatcher {
+  public:
+
+    CentralDispatcher();
+
+  static bool ParsePolitica(const std::string & nombre, PoliticaCentral & politica);
+
+  void Configurar(PoliticaCentral politica, const NodeContainer & centrales);
+  PoliticaCentral GetPolitica(void) const;
+
+  Ipv4Address SeleccionarCentral(Ptr < Node > notificador);
+  Ipv4Address CentralRespuesta(Ipv4Address centralSolicitud) const;
+
+  void RegistrarEntrada(uint32_t central, uint32_t idSolicitud);
+  void RegistrarSalida(uint32_t idSolicitud);
+  // Saca la solicitud del backlog sin respuesta (vencida o abandonada)
+  void Liberar(uint32_t idSolicitud);
+  uint32_t GetBacklog(uint32_t central) const;
+
+  void Print(std::ostream & os) const;
+
+  private:
+    struct EstadoCentral {
+      Ipv4Address ip;
+      Ptr < MobilityModel > mobility;
+      uint32_t backlog;
+      uint32_t maxBacklog;
+      uint64_t atendidas;
+      double areaBacklog; // integral del backlog en el tiempo
+      Time ultimoCambio;
+    };
+
+  static uint32_t Mezclar(uint32_t x);
+  void ActualizarArea(EstadoCentral & c);
+
+  // Cantidad de puntos virtuales de cada central en el anillo del hash
+  static const uint32_t VNODOS = 64;
+
+  PoliticaCentral m_politica;
+  std::vector < EstadoCentral > m_centrales;
+  std::map < uint32_t, uint32_t > m_anillo;
+  std::unordered_map < uint32_t, uint32_t > m_asignaciones;
+};
+
+CentralDispatcher::CentralDispatcher(): m_politica(CENTRAL_FIJA) {}
+
+bool CentralDispatcher::ParsePolitica(const std::string & nombre, PoliticaCentral & politica) {
+  if (nombre == "fija") {
+    politica = CENTRAL_FIJA;
+  } else if (nombre == "hash") {
+    politica = CENTRAL_HASH;
+  } else if (nombre == "cercana") {
+    politica = CENTRAL_CERCANA;
+  } else if (nombre == "menosCargada") {
+    politica = CENTRAL_MENOS_CARGADA;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+uint32_t CentralDispatcher::Mezclar(uint32_t x) {
+  // Finalizador de MurmurHash3: dispersa bien direcciones consecutivas
+  x ^= x >> 16;
+  x *= 0x85ebca6b;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35;
+  x ^= x >> 16;
+  return x;
+}
+
+void CentralDispatcher::Configurar(PoliticaCentral politica, const NodeContainer & centrales) {
+  NS_ABORT_MSG_IF(centrales.GetN() == 0, "Se necesita al menos un central");
+  m_politica = politica;
+  m_centrales.clear();
+  m_anillo.clear();
+  m_asignaciones.clear();
+  for (uint32_t i = 0; i < centrales.GetN(); i++) {
+    EstadoCentral c;
+    c.ip = centrales.Get(i) -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal();
+    c.mobility = centrales.Get(i) -> GetObject < MobilityModel > ();
+    c.backlog = 0;
+    c.maxBacklog = 0;
+    c.atendidas = 0;
+    c.areaBacklog = 0;
+    c.ultimoCambio = Simulator::Now();
+    m_centrales.push_back(c);
+    for (uint32_t v = 0; v < VNODOS; v++) {
+      m_anillo[Mezclar(i * VNODOS + v + 0x9e3779b9)] = i;
+    }
+  }
+}
+
+PoliticaCentral CentralDispatcher::GetPolitica(void) const {
+  return m_politica;
+}
+
+Ipv4Address CentralDispatcher::SeleccionarCentral(Ptr < Node > notificador) {
+  uint32_t elegido = 0;
+  switch (m_politica) {
+  case CENTRAL_FIJA:
+    break;
+  case CENTRAL_HASH: {
+    uint32_t h = Mezclar(notificador -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal().Get());
+    auto it = m_anillo.lower_bound(h);
+    elegido = (it == m_anillo.end()) ? m_anillo.begin() -> second : it -> second;
+    break;
+  }
+  case CENTRAL_CERCANA: {
+    Ptr < MobilityModel > m = notificador -> GetObject < MobilityModel > ();
+    double mejor = std::numeric_limits < double > ::max();
+    for (uint32_t i = 0; i < m_centrales.size(); i++) {
+      double d = m -> GetDistanceFrom(m_centrales[i].mobility);
+      if (d < mejor) {
+        mejor = d;
+        elegido = i;
+      }
+    }
+    break;
+  }
+  case CENTRAL_MENOS_CARGADA: {
+    for (uint32_t i = 1; i < m_centrales.size(); i++) {
+      if (m_centrales[i].backlog < m_centrales[elegido].backlog) {
+        elegido = i;
+      }
+    }
+    break;
+  }
+  }
+  return m_centrales[elegido].ip;
+}
+
+Ipv4Address CentralDispatcher::CentralRespuesta(Ipv4Address centralSolicitud) const {
+  if (m_politica == CENTRAL_FIJA) {
+    return m_centrales[std::min < std::size_t > (1, m_centrales.size() - 1)].ip;
+  }
+  return centralSolicitud;
+}
+
+void CentralDispatcher::ActualizarArea(EstadoCentral & c) {
+  Time ahora = Simulator::Now();
+  c.areaBacklog += c.backlog * (ahora - c.ultimoCambio).GetSeconds();
+  c.ultimoCambio = ahora;
+}
+
+void CentralDispatcher::RegistrarEntrada(uint32_t central, uint32_t idSolicitud) {
+  NS_ASSERT(central < m_centrales.size());
+  // Un reintento de una solicitud que sigue asignada (quizás a otro
+  // central) reemplaza la asignación anterior en lugar de sumarse
+  Liberar(idSolicitud);
+  EstadoCentral & c = m_centrales[central];
+  ActualizarArea(c);
+  c.backlog++;
+  c.maxBacklog = std::max(c.maxBacklog, c.backlog);
+  c.atendidas++;
+  m_asignaciones[idSolicitud] = central;
+}
+
+void CentralDispatcher::RegistrarSalida(uint32_t idSolicitud) {
+  Liberar(idSolicitud);
+}
+
+void CentralDispatcher::Liberar(uint32_t idSolicitud) {
+  auto it = m_asignaciones.find(idSolicitud);
+  if (it == m_asignaciones.end()) {
+    return;
+  }
+  EstadoCentral & c = m_centrales[it -> second];
+  ActualizarArea(c);
+  c.backlog--;
+  m_asignaciones.erase(it);
+}
+
+uint32_t CentralDispatcher::GetBacklog(uint32_t central) const {
+  return central < m_centrales.size() ? m_centrales[central].backlog : 0;
+}
+
+void CentralDispatcher::Print(std::ostream & os) const {
+  double t = Simulator::Now().GetSeconds();
+  for (uint32_t i = 0; i < m_centrales.size(); i++) {
+    const EstadoCentral & c = m_centrales[i];
+    double area = c.areaBacklog + c.backlog * (Simulator::Now() - c.ultimoCambio).GetSeconds();
+    os << "Central " << i << " (" << c.ip << "): solicitudes " << c.atendidas <<
+      ", backlog actual " << c.backlog <<
+      ", máximo " << c.maxBacklog <<
+      ", promedio " << (t > 0 ? area / t : 0) << "\n";
+  }
+}
+
+// Políticas para elegir el rescatista que atiende una solicitud
+enum PoliticaRescatista {
+  RESCATISTA_ALEATORIO = 0, // uniforme, como en la versión original
+  RESCATISTA_CERCANO = 1, // más cercano al notificador
+  RESCATISTA_MENOS_CARGADO = 2, // menos asignaciones pendientes
+  RESCATISTA_MENOS_SALTOS = 3 // menos saltos desde los centrales
+};
+
+// Selector de rescatistas. Cada política mantiene su propia estructura para
+// elegir en O(log N) o mejor:
+//  - cercano: malla uniforme de posiciones actualizada con CourseChange y
+//    búsqueda por anillos alrededor del notificador;
+//  - menos cargado: conjunto ordenado por asignaciones pendientes (enviadas
+//    por un central y aún no recibidas por el rescatista);
+//  - menos saltos: conjunto ordenado por costo, uno por central. AODV y
+//    DSDV no exponen su tabla de rutas, así que los saltos entre un central
+//    y un rescatista se toman del TTL IP de los paquetes que se cruzan (la
+//    solicitud que llega al rescatista y la respuesta que llega al
+//    central), que recorren las rutas del protocolo activo. Cada central
+//    elige con su propia tabla. Los rescatistas sin medición aún cuentan
+//    como a un salto para que se exploren primero, y cada asignación
+//    pendiente suma un salto: un rescatista sin ruta acumula asignaciones
+//    que nunca le llegan y deja de elegirse, y en el arranque los empates
+//    se reparten en vez de ir todos al primero.
+class RescuerSelector {
+  public:
+
+    RescuerSelector();
+
+  static bool ParsePolitica(const std::string & nombre, PoliticaRescatista & politica);
+
+  void Configurar(PoliticaRescatista politica, const NodeContainer & rescatistas, uint32_t numCentrales,
+    Ptr < UniformRandomVariable > aleatorio, const IpNodeIndex * ipIndex, double margen);
+  uint32_t Seleccionar(Ipv4Address notificador, uint32_t central);
+
+  void RegistrarAsignacion(uint32_t rescatista);
+  void RegistrarAtencion(uint32_t rescatista);
+  void RegistrarSaltos(uint32_t central, uint32_t rescatista, uint32_t saltos);
+
+  private:
+    uint32_t SeleccionarCercano(Ipv4Address notificador);
+  uint64_t Celda(int32_t cx, int32_t cy) const;
+  void Ubicar(uint32_t rescatista);
+  void CourseChanged(Ptr <
+    const MobilityModel > mobility);
+  uint32_t CostoSaltos(uint32_t central, uint32_t rescatista) const;
+  void CambiarCarga(uint32_t rescatista, uint32_t carga);
+
+  // Tamaño de celda de la malla (m) y margen mínimo por el movimiento de
+  // los nodos entre notificaciones de CourseChange; RandomWalk2d avisa en
+  // cada tramo de 1 m
+  static constexpr double TAMANO_CELDA = 25.0;
+  static constexpr double MARGEN = 5.0;
+  // Saltos que suma al costo cada asignación aún no recibida
+  static const uint32_t PENALIZACION_PENDIENTE = 1;
+
+  PoliticaRescatista m_politica;
+  double m_margen;
+  Ptr < UniformRandomVariable > m_aleatorio;
+  const IpNodeIndex * m_ipIndex;
+  std::vector < Ptr < MobilityModel > > m_mobility;
+
+  std::vector < uint32_t > m_carga;
+  std::set < std::pair < uint32_t, uint32_t > > m_porCarga;
+  // Saltos medidos y conjunto ordenado por costo de cada central
+  std::vector < std::vector < uint32_t > > m_saltos;
+  std::vector < std::set < std::pair < uint32_t, uint32_t > > > m_porSaltos;
+
+  std::unordered_map < uint64_t, std::vector < uint32_t > > m_celdas;
+  std::vector < uint64_t > m_celdaDe;
+  std::unordered_map < const MobilityModel * , uint32_t > m_porMovilidad;
+};
+
+RescuerSelector::RescuerSelector(): m_politica(RESCATISTA_ALEATORIO),
+  m_margen(MARGEN),
+  m_ipIndex(nullptr) {}
+
+bool RescuerSelector::ParsePolitica(const std::string & nombre, PoliticaRescatista & politica) {
+  if (nombre == "aleatorio") {
+    politica = RESCATISTA_ALEATORIO;
+  } else if (nombre == "cercano") {
+    politica = RESCATISTA_CERCANO;
+  } else if (nombre == "menosCargado") {
+    politica = RESCATISTA_MENOS_CARGADO;
+  } else if (nombre == "menosSaltos") {
+    politica = RESCATISTA_MENOS_SALTOS;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void RescuerSelector::Configurar(PoliticaRescatista politica, const NodeContainer & rescatistas, uint32_t numCentrales,
+  Ptr < UniformRandomVariable > aleatorio, const IpNodeIndex * ipIndex, double margen) {
+  NS_ABORT_MSG_IF(rescatistas.GetN() == 0, "Se necesita al menos un rescatista");
+  m_politica = politica;
+  m_margen = std::max(margen, MARGEN);
+  m_aleatorio = aleatorio;
+  m_ipIndex = ipIndex;
+  uint32_t n = rescatistas.GetN();
+  m_mobility.assign(n, nullptr);
+  m_carga.assign(n, 0);
+  m_saltos.assign(numCentrales, std::vector < uint32_t > (n, 1));
+  m_porCarga.clear();
+  m_porSaltos.assign(numCentrales, std::set < std::pair < uint32_t, uint32_t > > ());
+  m_celdas.clear();
+  m_celdaDe.assign(n, 0);
+  m_porMovilidad.clear();
+  for (uint32_t i = 0; i < n; i++) {
+    m_porCarga.insert(std::make_pair(0, i));
+    for (auto & porSaltos: m_porSaltos) {
+      porSaltos.insert(std::make_pair(1, i));
+    }
+    m_mobility[i] = rescatistas.Get(i) -> GetObject < MobilityModel > ();
+    if (m_politica == RESCATISTA_CERCANO) {
+      NS_ABORT_MSG_IF(!m_mobility[i], "La política cercano requiere movilidad en los rescatistas");
+      m_porMovilidad[PeekPointer(m_mobility[i])] = i;
+      Vector p = m_mobility[i] -> GetPosition();
+      m_celdaDe[i] = Celda(static_cast < int32_t > (std::floor(p.x / TAMANO_CELDA)),
+        static_cast < int32_t > (std::floor(p.y / TAMANO_CELDA)));
+      m_celdas[m_celdaDe[i]].push_back(i);
+      m_mobility[i] -> TraceConnectWithoutContext("CourseChange",
+        MakeCallback( & RescuerSelector::CourseChanged, this));
+    }
+  }
+}
+
+uint64_t RescuerSelector::Celda(int32_t cx, int32_t cy) const {
+  return (static_cast < uint64_t > (static_cast < uint32_t > (cx)) << 32) | static_cast < uint32_t > (cy);
+}
+
+void RescuerSelector::Ubicar(uint32_t rescatista) {
+  Vector p = m_mobility[rescatista] -> GetPosition();
+  uint64_t nueva = Celda(static_cast < int32_t > (std::floor(p.x / TAMANO_CELDA)),
+    static_cast < int32_t > (std::floor(p.y / TAMANO_CELDA)));
+  if (nueva == m_celdaDe[rescatista]) {
+    return;
+  }
+  std::vector < uint32_t > & anterior = m_celdas[m_celdaDe[rescatista]];
+  anterior.erase(std::find(anterior.begin(), anterior.end(), rescatista));
+  m_celdas[nueva].push_back(rescatista);
+  m_celdaDe[rescatista] = nueva;
+}
+
+void RescuerSelector::CourseChanged(Ptr <
+  const MobilityModel > mobility) {
+  auto it = m_porMovilidad.find(PeekPointer(mobility));
+  if (it != m_porMovilidad.end()) {
+    Ubicar(it -> second);
+  }
+}
+
+uint32_t RescuerSelector::SeleccionarCercano(Ipv4Address notificador) {
+  const IpNodeIndex::Entrada * entrada = m_ipIndex -> Lookup(notificador);
+  Ptr < MobilityModel > m = entrada ? entrada -> node -> GetObject < MobilityModel > () : nullptr;
+  if (!m) {
+    return m_aleatorio -> GetInteger(0, m_mobility.size() - 1);
+  }
+  Vector p = m -> GetPosition();
+  int32_t cx = static_cast < int32_t > (std::floor(p.x / TAMANO_CELDA));
+  int32_t cy = static_cast < int32_t > (std::floor(p.y / TAMANO_CELDA));
+
+  // Se recorren anillos de celdas cada vez más lejanos. El notificador
+  // puede estar en cualquier punto de su celda, así que los rescatistas del
+  // anillo r están al menos a (r - 1) * TAMANO_CELDA (menos el margen) y se
+  // puede parar en cuanto el mejor está más cerca que eso
+  double mejor = std::numeric_limits < double > ::max();
+  uint32_t elegido = 0;
+  std::size_t vistos = 0;
+  for (int32_t r = 0; vistos < m_mobility.size(); r++) {
+    if (mejor <= (r - 1) * TAMANO_CELDA - m_margen) {
+      break;
+    }
+    for (int32_t dx = -r; dx <= r; dx++) {
+      for (int32_t dy = -r; dy <= r; dy++) {
+        if (std::max(std::abs(dx), std::abs(dy)) != r) {
+          continue;
+        }
+        auto it = m_celdas.find(Celda(cx + dx, cy + dy));
+        if (it == m_celdas.end()) {
+          continue;
+        }
+        for (uint32_t i: it -> second) {
+          vistos++;
+          double d = m -> GetDistanceFrom(m_mobility[i]);
+          if (d < mejor) {
+            mejor = d;
+            elegido = i;
+          }
+        }
+      }
+    }
+  }
+  return elegido;
+}
+
+uint32_t RescuerSelector::Seleccionar(Ipv4Address notificador, uint32_t central) {
+  switch (m_politica) {
+  case RESCATISTA_CERCANO:
+    return SeleccionarCercano(notificador);
+  case RESCATISTA_MENOS_CARGADO:
+    return m_porCarga.begin() -> second;
+  case RESCATISTA_MENOS_SALTOS:
+    NS_ASSERT(central < m_porSaltos.size());
+    return m_porSaltos[central].begin() -> second;
+  case RESCATISTA_ALEATORIO:
+  default:
+    return m_aleatorio -> GetInteger(0, m_mobility.size() - 1); // selecciona un índice aleatorio
+  }
+}
+
+uint32_t RescuerSelector::CostoSaltos(uint32_t central, uint32_t rescatista) const {
+  return m_saltos[central][rescatista] + PENALIZACION_PENDIENTE * m_carga[rescatista];
+}
+
+// La carga entra en el costo de todas las centrales, así que se reubica el
+// rescatista en cada conjunto
+void RescuerSelector::CambiarCarga(uint32_t rescatista, uint32_t carga) {
+  m_porCarga.erase(std::make_pair(m_carga[rescatista], rescatista));
+  for (uint32_t c = 0; c < m_porSaltos.size(); c++) {
+    m_porSaltos[c].erase(std::make_pair(CostoSaltos(c, rescatista), rescatista));
+  }
+  m_carga[rescatista] = carga;
+  m_porCarga.insert(std::make_pair(carga, rescatista));
+  for (uint32_t c = 0; c < m_porSaltos.size(); c++) {
+    m_porSaltos[c].insert(std::make_pair(CostoSaltos(c, rescatista), rescatista));
+  }
+}
+
+void RescuerSelector::RegistrarAsignacion(uint32_t rescatista) {
+  CambiarCarga(rescatista, m_carga[rescatista] + 1);
+}
+void RescuerSelector::RegistrarAtencion(uint32_t rescatista) {
+  if (rescatista >= m_carga.size() || m_carga[rescatista] == 0) {
+    return;
+  }
+  CambiarCarga(rescatista, m_carga[rescatista] - 1);
+}
+void RescuerSelector::RegistrarSaltos(uint32_t central, uint32_t rescatista, uint32_t saltos) {
+  if (central >= m_saltos.size() || rescatista >= m_saltos[central].size() || m_saltos[central][rescatista] == saltos) {
+    return;
+  }
+  m_porSaltos[central].erase(std::make_pair(CostoSaltos(central, rescatista), rescatista));
+  m_saltos[central][rescatista] = saltos;
+  m_porSaltos[central].insert(std::make_pair(CostoSaltos(central, rescatista), rescatista));
+}
+
+// Contabilidad del tráfico de control del enrutamiento frente al de datos.
+// Se engancha a las fuentes de traza Tx/Rx de Ipv4L3Protocol y a los
+// MonitorSniffer Tx/Rx del PHY wifi de cada nodo, clasifica cada paquete por
+// protocolo y puerto, y acumula paquetes, bytes y tiempo de aire en arreglos
+// fijos por nodo: no se reserva memoria por paquete.
+enum CategoriaTrafico {
+  TRAFICO_DATOS = 0, // solicitudes y respuestas de la aplicación
+  TRAFICO_AODV, // RREQ/RREP/RERR, UDP 654
+  TRAFICO_OLSR, // HELLO/TC, UDP 698
+  TRAFICO_DSDV, // actualizaciones, UDP 269
+  TRAFICO_DSR, // protocolo IP 48 (control; los datos encapsulados van en TRAFICO_DATOS)
+  TRAFICO_ARP,
+  TRAFICO_MAC, // tramas de control y gestión 802.11 (ACK, RTS/CTS, ...)
+  TRAFICO_OTRO,
+  NUM_CATEGORIAS
+};
+
+enum CapaTrafico {
+  CAPA_L3_TX = 0,
+  CAPA_L3_RX,
+  CAPA_PHY_TX,
+  CAPA_PHY_RX,
+  NUM_CAPAS
+};
+
+class RoutingOverheadStats {
+  public:
+
+    void Instalar(NodeContainer nodos, const IpNodeIndex & ipIndex);
+  void Print(std::ostream & os) const;
+  void WriteCsv(const std::string & fileName, const std::string & protocolo) const;
+
+  static CategoriaTrafico ClasificarIp(const uint8_t * ip, uint32_t largo);
+  static CategoriaTrafico ClasificarTrama(Ptr < const Packet > trama);
+  static const char * NombreCategoria(uint32_t categoria);
+  static const char * NombreCapa(uint32_t capa);
+
+  // Callbacks de las fuentes de traza; los primeros argumentos son los
+  // contadores y el índice del nodo
+  static void L3Tx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet, Ptr < Ipv4 > ipv4,
+    uint32_t interfaz);
+  static void L3Rx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet, Ptr < Ipv4 > ipv4,
+    uint32_t interfaz);
+  static void PhyTx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet, uint16_t frecuencia,
+    WifiTxVector txVector, MpduInfo mpdu, uint16_t staId);
+  static void PhyRx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet, uint16_t frecuencia,
+    WifiTxVector txVector, MpduInfo mpdu, SignalNoiseDbm senal, uint16_t staId);
+
+  private: struct Contadores {
+    uint64_t paquetes[NUM_CAPAS][NUM_CATEGORIAS];
+    uint64_t bytes[NUM_CAPAS][NUM_CATEGORIAS];
+    int64_t airtimeNs[NUM_CAPAS][NUM_CATEGORIAS];
+  };
+
+  void Sumar(uint32_t nodo, CapaTrafico capa, CategoriaTrafico categoria, uint32_t bytes, int64_t airtimeNs);
+  Contadores Total(void) const;
+
+  std::vector < Contadores > m_nodos;
+  std::vector < WifiPhyBand > m_bandas;
+  std::vector < RolNodo > m_roles;
+};
+
+// Puertos UDP de los protocolos de enrutamiento de ns-3
+const uint16_t PUERTO_AODV = 654;
+const uint16_t PUERTO_OLSR = 698;
+const uint16_t PUERTO_DSDV = 269;
+
+// Cabecera fija de DSR en ns-3 (DsrFixedSizeHeader): next header, tipo de
+// mensaje (1 control, 2 datos), ids de origen y destino y largo de las
+// opciones, este último escrito con WriteU16 (little-endian)
+const uint8_t PROTOCOLO_DSR = 48;
+const uint32_t LARGO_CABECERA_DSR = 8;
+const uint8_t MENSAJE_DSR_DATOS = 2;
+// Bytes copiados de cada paquete para clasificarlo: IPv4 con opciones, DSR
+// con una ruta de origen larga y los puertos UDP
+const uint32_t LARGO_CLASIFICACION = 160;
+
+void RoutingOverheadStats::Instalar(NodeContainer nodos, const IpNodeIndex & ipIndex) {
+  m_nodos.assign(nodos.GetN(), Contadores());
+  m_bandas.assign(nodos.GetN(), WIFI_PHY_BAND_2_4GHZ);
+  m_roles.assign(nodos.GetN(), ROL_DESCONOCIDO);
+
+  for (uint32_t i = 0; i < nodos.GetN(); i++) {
+    Ptr < Node > node = nodos.Get(i);
+    const IpNodeIndex::Entrada * entrada = ipIndex.Lookup(node -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal());
+    if (entrada) {
+      m_roles[i] = entrada -> rol;
+    }
+
+    Ptr < Ipv4L3Protocol > l3 = node -> GetObject < Ipv4L3Protocol > ();
+    l3 -> TraceConnectWithoutContext("Tx", MakeBoundCallback( & RoutingOverheadStats::L3Tx, this, i));
+    l3 -> TraceConnectWithoutContext("Rx", MakeBoundCallback( & RoutingOverheadStats::L3Rx, this, i));
+
+    for (uint32_t d = 0; d < node -> GetNDevices(); d++) {
+      Ptr < WifiNetDevice > dev = DynamicCast < WifiNetDevice > (node -> GetDevice(d));
+      if (!dev) {
+        continue;
+      }
+      Ptr < WifiPhy > phy = dev -> GetPhy();
+      m_bandas[i] = phy -> GetPhyBand();
+      phy -> TraceConnectWithoutContext("MonitorSnifferTx", MakeBoundCallback( & RoutingOverheadStats::PhyTx, this, i));
+      phy -> TraceConnectWithoutContext("MonitorSnifferRx", MakeBoundCallback( & RoutingOverheadStats::PhyRx, this, i));
+    }
+  }
+}
+
+CategoriaTrafico RoutingOverheadStats::ClasificarIp(const uint8_t * ip, uint32_t largo) {
+  if (largo < 20 || (ip[0] >> 4) != 4) {
+    return TRAFICO_OTRO;
+  }
+  uint32_t ihl = (ip[0] & 0x0f) * 4;
+  uint8_t protocolo = ip[9];
+  if (protocolo == PROTOCOLO_DSR) {
+    // Solo los paquetes de datos de DSR llevan el UDP original detrás de
+    // la ruta de origen; los de control repiten el next header sin payload
+    const uint8_t * dsr = ip + ihl;
+    if (largo < ihl + LARGO_CABECERA_DSR || dsr[0] != UdpL4Protocol::PROT_NUMBER || dsr[1] != MENSAJE_DSR_DATOS) {
+      return TRAFICO_DSR;
+    }
+    uint32_t opciones = dsr[6] | (dsr[7] << 8);
+    uint32_t udp = ihl + LARGO_CABECERA_DSR + opciones;
+    if (largo < udp + 4) {
+      return TRAFICO_DSR;
+    }
+    uint16_t destino = (ip[udp + 2] << 8) | ip[udp + 3];
+    if (destino == PUERTO_SOLICITUDES || destino == PUERTO_RESPUESTAS || destino == PUERTO_ENTREGAS ||
+      destino == PUERTO_AGREGADOS) {
+      return TRAFICO_DATOS;
+    }
+    return TRAFICO_DSR;
+  }
+  if (protocolo != UdpL4Protocol::PROT_NUMBER || largo < ihl + 4) {
+    return TRAFICO_OTRO;
+  }
+  uint16_t origen = (ip[ihl] << 8) | ip[ihl + 1];
+  uint16_t destino = (ip[ihl + 2] << 8) | ip[ihl + 3];
+  if (destino == PUERTO_SOLICITUDES || destino == PUERTO_RESPUESTAS || destino == PUERTO_ENTREGAS ||
+    destino == PUERTO_AGREGADOS) {
+    return TRAFICO_DATOS;
+  }
+  if (origen == PUERTO_AODV || destino == PUERTO_AODV) {
+    return TRAFICO_AODV;
+  }
+  if (origen == PUERTO_OLSR || destino == PUERTO_OLSR) {
+    return TRAFICO_OLSR;
+  }
+  if (origen == PUERTO_DSDV || destino == PUERTO_DSDV) {
+    return TRAFICO_DSDV;
+  }
+  return TRAFICO_OTRO;
+}
+
+CategoriaTrafico RoutingOverheadStats::ClasificarTrama(Ptr < const Packet > trama) {
+  WifiMacHeader mac;
+  uint32_t largoMac = trama -> PeekHeader(mac);
+  if (!mac.IsData()) {
+    return TRAFICO_MAC;
+  }
+  // Cabecera MAC + LLC/SNAP (8) + lo que ClasificarIp necesita del paquete
+  uint8_t buf[64 + LARGO_CLASIFICACION];
+  uint32_t largo = trama -> CopyData(buf, std::min < uint32_t > (sizeof(buf), largoMac + 8 + LARGO_CLASIFICACION));
+  if (largo < largoMac + 8) {
+    return TRAFICO_OTRO;
+  }
+  const uint8_t * llc = buf + largoMac;
+  uint16_t etherType = (llc[6] << 8) | llc[7];
+  if (etherType == 0x0806) {
+    return TRAFICO_ARP;
+  }
+  if (etherType != 0x0800) {
+    return TRAFICO_OTRO;
+  }
+  return ClasificarIp(llc + 8, largo - largoMac - 8);
+}
+
+void RoutingOverheadStats::Sumar(uint32_t nodo, CapaTrafico capa, CategoriaTrafico categoria,
+  uint32_t bytes, int64_t airtimeNs) {
+  Contadores & c = m_nodos[nodo];
+  c.paquetes[capa][categoria]++;
+  c.bytes[capa][categoria] += bytes;
+  c.airtimeNs[capa][categoria] += airtimeNs;
+}
+
+void RoutingOverheadStats::L3Tx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet,
+  Ptr < Ipv4 > ipv4, uint32_t interfaz) {
+  uint8_t buf[LARGO_CLASIFICACION];
+  uint32_t largo = packet -> CopyData(buf, sizeof(buf));
+  stats -> Sumar(nodo, CAPA_L3_TX, ClasificarIp(buf, largo), packet -> GetSize(), 0);
+}
+
+void RoutingOverheadStats::L3Rx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet,
+  Ptr < Ipv4 > ipv4, uint32_t interfaz) {
+  uint8_t buf[LARGO_CLASIFICACION];
+  uint32_t largo = packet -> CopyData(buf, sizeof(buf));
+  stats -> Sumar(nodo, CAPA_L3_RX, ClasificarIp(buf, largo), packet -> GetSize(), 0);
+}
+
+void RoutingOverheadStats::PhyTx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet,
+  uint16_t frecuencia, WifiTxVector txVector, MpduInfo mpdu, uint16_t staId) {
+  Time airtime = WifiPhy::CalculateTxDuration(packet -> GetSize(), txVector, stats -> m_bandas[nodo]);
+  stats -> Sumar(nodo, CAPA_PHY_TX, ClasificarTrama(packet), packet -> GetSize(), airtime.GetTimeStep());
+}
+
+void RoutingOverheadStats::PhyRx(RoutingOverheadStats * stats, uint32_t nodo, Ptr < const Packet > packet,
+  uint16_t frecuencia, WifiTxVector txVector, MpduInfo mpdu, SignalNoiseDbm senal, uint16_t staId) {
+  Time airtime = WifiPhy::CalculateTxDuration(packet -> GetSize(), txVector, stats -> m_bandas[nodo]);
+  stats -> Sumar(nodo, CAPA_PHY_RX, ClasificarTrama(packet), packet -> GetSize(), airtime.GetTimeStep());
+}
+
+const char * RoutingOverheadStats::NombreCategoria(uint32_t categoria) {
+  static const char * nombres[NUM_CATEGORIAS] = {
+    "datos",
+    "aodv",
+    "olsr",
+    "dsdv",
+    "dsr",
+    "arp",
+    "mac",
+    "otro"
+  };
+  return nombres[categoria];
+}
+
+const char * RoutingOverheadStats::NombreCapa(uint32_t capa) {
+  static const char * nombres[NUM_CAPAS] = {
+    "l3-tx",
+    "l3-rx",
+    "phy-tx",
+    "phy-rx"
+  };
+  return nombres[capa];
+}
+
+RoutingOverheadStats::Contadores RoutingOverheadStats::Total(void) const {
+  Contadores total;
+  std::memset( & total, 0, sizeof(total));
+  for (const Contadores & c: m_nodos) {
+    for (uint32_t k = 0; k < NUM_CAPAS; k++) {
+      for (uint32_t j = 0; j < NUM_CATEGORIAS; j++) {
+        total.paquetes[k][j] += c.paquetes[k][j];
+        total.bytes[k][j] += c.bytes[k][j];
+        total.airtimeNs[k][j] += c.airtimeNs[k][j];
+      }
+    }
+  }
+  return total;
+}
+
+void RoutingOverheadStats::Print(std::ostream & os) const {
+  if (m_nodos.empty()) {
+    return;
+  }
+  Contadores total = Total();
+  // Control = todo lo que no es tráfico de la aplicación
+  uint64_t bytesControl = 0;
+  int64_t airtimeControl = 0;
+  int64_t airtimeTotal = 0;
+  for (uint32_t j = 0; j < NUM_CATEGORIAS; j++) {
+    airtimeTotal += total.airtimeNs[CAPA_PHY_TX][j];
+    if (j != TRAFICO_DATOS) {
+      bytesControl += total.bytes[CAPA_L3_TX][j];
+      airtimeControl += total.airtimeNs[CAPA_PHY_TX][j];
+    }
+  }
+  os << "Overhead de enrutamiento: " << bytesControl << " bytes IP de control frente a " <<
+    total.bytes[CAPA_L3_TX][TRAFICO_DATOS] << " de datos; tiempo de aire de control " <<
+    TimeStep(airtimeControl).GetSeconds() << " s de " << TimeStep(airtimeTotal).GetSeconds() << " s transmitidos\n";
+}
+
+void RoutingOverheadStats::WriteCsv(const std::string & fileName, const std::string & protocolo) const {
+  if (m_nodos.empty()) {
+    return;
+  }
+  std::ofstream out(fileName.c_str(), std::ios::out | std::ios::trunc);
+  if (!out.is_open()) {
+    NS_LOG_ERROR("No se pudo abrir el archivo de overhead: " << fileName);
+    return;
+  }
+  static const char * roles[] = {
+    "notificador",
+    "rescatista",
+    "central",
+    "desconocido"
+  };
+  // Una fila por nodo, capa y categoría con tráfico, más las filas "total"
+  out << "Protocolo,Nodo,Rol,Capa,Categoria,Paquetes,Bytes,Tiempo de aire (s)\n";
+  Contadores total = Total();
+  for (uint32_t i = 0; i <= m_nodos.size(); i++) {
+    const Contadores & c = i < m_nodos.size() ? m_nodos[i] : total;
+    for (uint32_t k = 0; k < NUM_CAPAS; k++) {
+      for (uint32_t j = 0; j < NUM_CATEGORIAS; j++) {
+        if (c.paquetes[k][j] == 0) {
+          continue;
+        }
+        if (i < m_nodos.size()) {
+          out << protocolo << "," << i << "," << roles[m_roles[i]];
+        } else {
+          out << protocolo << ",total,todos";
+        }
+        out << "," << NombreCapa(k) << "," << NombreCategoria(j) << "," << c.paquetes[k][j] << "," <<
+          c.bytes[k][j] << "," << TimeStep(c.airtimeNs[k][j]).GetSeconds() << "\n";
+      }
+    }
+  }
+}
+
+// Muestreo periódico del estado de la red: cada intervalo se registra por
+// nodo el largo de la cola MAC wifi, el tamaño de la tabla de rutas del
+// protocolo activo y el número de vecinos dentro del rango de recepción.
+// Las muestras se guardan en un buffer circular reservado de antemano y se
+// escriben en bloque cuando se llena o al terminar la corrida.
+class TimeSeriesSampler {
+  public:
+
+    TimeSeriesSampler();
+  ~TimeSeriesSampler();
+
+  void Configurar(NodeContainer nodos, Time intervalo, double rango, std::size_t capacidad);
+  void SetFileName(const std::string & fileName);
+  void Volcar(void);
+  void Cerrar(void);
+
+  uint64_t GetMuestras(void) const;
+
+  private: struct Muestra {
+    int64_t tiempoNs;
+    uint32_t nodo;
+    uint32_t colaMac;
+    uint32_t rutas;
+    uint32_t vecinos;
+  };
+
+  void Muestrear(void);
+  uint32_t ContarRutas(uint32_t nodo);
+  void ContarVecinos(void);
+  double RangoPorDefecto(void) const;
+
+  NodeContainer m_nodos;
+  std::vector < Ptr < WifiMac > > m_macs;
+  Time m_intervalo;
+  double m_rango;
+  EventId m_evento;
+
+  // Buffer circular: m_inicio es la muestra más antigua sin escribir
+  std::vector < Muestra > m_buffer;
+  std::size_t m_inicio;
+  std::size_t m_cantidad;
+  uint64_t m_muestras;
+
+  std::string m_fileName;
+  std::ofstream m_out;
+  std::ostringstream m_tabla;
+
+  // Malla de posiciones para contar vecinos, reutilizada en cada muestra
+  std::unordered_map < uint64_t, std::vector < uint32_t > > m_celdas;
+  std::vector < Vector > m_posiciones;
+  std::vector < uint32_t > m_vecinos;
+};
+
+TimeSeriesSampler::TimeSeriesSampler(): m_rango(0),
+  m_inicio(0),
+  m_cantidad(0),
+  m_muestras(0) {}
+
+TimeSeriesSampler::~TimeSeriesSampler() {
+  Cerrar();
+}
+
+void TimeSeriesSampler::Configurar(NodeContainer nodos, Time intervalo, double rango, std::size_t capacidad) {
+  m_nodos = nodos;
+  m_intervalo = intervalo;
+  m_buffer.assign(std::max < std::size_t > (capacidad, nodos.GetN()), Muestra());
+  m_inicio = 0;
+  m_cantidad = 0;
+  m_macs.assign(nodos.GetN(), nullptr);
+  for (uint32_t i = 0; i < nodos.GetN(); i++) {
+    for (uint32_t d = 0; d < nodos.Get(i) -> GetNDevices(); d++) {
+      Ptr < WifiNetDevice > dev = DynamicCast < WifiNetDevice > (nodos.Get(i) -> GetDevice(d));
+      if (dev) {
+        m_macs[i] = dev -> GetMac();
+        break;
+      }
+    }
+  }
+  m_rango = rango > 0 ? rango : RangoPorDefecto();
+  m_posiciones.resize(nodos.GetN());
+  m_vecinos.resize(nodos.GetN());
+  m_evento = Simulator::Schedule(Seconds(0), & TimeSeriesSampler::Muestrear, this);
+}
+
+double TimeSeriesSampler::RangoPorDefecto(void) const {
+  // Alcance con el mismo modelo de pérdidas del escenario (Friis) y el PHY
+  // del primer nodo. Con el canal espacial el escenario pasa su rango de corte.
+  for (uint32_t i = 0; i < m_macs.size(); i++) {
+    if (!m_macs[i]) {
+      continue;
+    }
+    Ptr < WifiPhy > phy = DynamicCast < WifiNetDevice > (m_macs[i] -> GetDevice()) -> GetPhy();
+    return RangoRecepcion(CreateObject < FriisPropagationLossModel > (),
+      phy -> GetTxPowerEnd() + phy -> GetTxGain(), phy -> GetRxSensitivity() - phy -> GetRxGain());
+  }
+  return 0;
+}
+
+void TimeSeriesSampler::SetFileName(const std::string & fileName) {
+  Cerrar();
+  m_fileName = fileName;
+}
+
+uint32_t TimeSeriesSampler::ContarRutas(uint32_t nodo) {
+  // Los protocolos no exponen sus tablas; se imprime la tabla y se cuentan
+  // las entradas (líneas que empiezan con una dirección IP)
+  Ptr < Ipv4RoutingProtocol > routing = m_nodos.Get(nodo) -> GetObject < Ipv4 > () -> GetRoutingProtocol();
+  if (!routing) {
+    return 0;
+  }
+  m_tabla.str("");
+  m_tabla.clear();
+  routing -> PrintRoutingTable(Create < OutputStreamWrapper > ( & m_tabla));
+  const std::string & texto = m_tabla.str();
+  uint32_t entradas = 0;
+  bool inicioLinea = true;
+  for (char c: texto) {
+    if (inicioLinea && std::isdigit(static_cast < unsigned char > (c))) {
+      entradas++;
+    }
+    inicioLinea = c == '\n';
+  }
+  return entradas;
+}
+
+void TimeSeriesSampler::ContarVecinos(void) {
+  // Malla de celdas del tamaño del rango: los vecinos de un nodo sólo
+  // pueden estar en su celda o en las 8 de alrededor
+  for (auto & celda: m_celdas) {
+    celda.second.clear();
+  }
+  auto clave = [](int64_t cx, int64_t cy) {
+    return (static_cast < uint64_t > (cx) << 32) ^ static_cast < uint32_t > (cy);
+  };
+  for (uint32_t i = 0; i < m_nodos.GetN(); i++) {
+    Ptr < MobilityModel > mob = m_nodos.Get(i) -> GetObject < MobilityModel > ();
+    m_posiciones[i] = mob ? mob -> GetPosition() : Vector();
+    m_celdas[clave(std::floor(m_posiciones[i].x / m_rango), std::floor(m_posiciones[i].y / m_rango))].push_back(i);
+  }
+  double rango2 = m_rango * m_rango;
+  for (uint32_t i = 0; i < m_nodos.GetN(); i++) {
+    int64_t cx = std::floor(m_posiciones[i].x / m_rango);
+    int64_t cy = std::floor(m_posiciones[i].y / m_rango);
+    uint32_t vecinos = 0;
+    for (int64_t dx = -1; dx <= 1; dx++) {
+      for (int64_t dy = -1; dy <= 1; dy++) {
+        auto it = m_celdas.find(clave(cx + dx, cy + dy));
+        if (it == m_celdas.end()) {
+          continue;
+        }
+        for (uint32_t j: it -> second) {
+          if (j != i && CalculateDistanceSquared(m_posiciones[i], m_posiciones[j]) <= rango2) {
+            vecinos++;
+          }
+        }
+      }
+    }
+    m_vecinos[i] = vecinos;
+  }
+}
+
+void TimeSeriesSampler::Muestrear(void) {
+  if (m_rango > 0) {
+    ContarVecinos();
+  }
+  int64_t ahora = Simulator::Now().GetTimeStep();
+  for (uint32_t i = 0; i < m_nodos.GetN(); i++) {
+    if (m_cantidad == m_buffer.size()) {
+      Volcar();
+    }
+    Muestra & m = m_buffer[(m_inicio + m_cantidad) % m_buffer.size()];
+    m.tiempoNs = ahora;
+    m.nodo = i;
+    m.colaMac = 0;
+    if (m_macs[i]) {
+      Ptr < WifiMacQueue > cola = m_macs[i] -> GetTxopQueue(m_macs[i] -> GetQosSupported() ? AC_BE : AC_BE_NQOS);
+      m.colaMac = cola ? cola -> GetNPackets() : 0;
+    }
+    m.rutas = ContarRutas(i);
+    m.vecinos = m_rango > 0 ? m_vecinos[i] : 0;
+    m_cantidad++;
+    m_muestras++;
+  }
+  m_evento = Simulator::Schedule(m_intervalo, & TimeSeriesSampler::Muestrear, this);
+}
+
+void TimeSeriesSampler::Volcar(void) {
+  if (m_cantidad == 0) {
+    return;
+  }
+  if (m_fileName.empty()) {
+    // Sin archivo las muestras se descartan; si no, m_cantidad seguiría
+    // creciendo más allá de la capacidad del buffer circular
+    m_inicio = (m_inicio + m_cantidad) % m_buffer.size();
+    m_cantidad = 0;
+    return;
+  }
+  if (!m_out.is_open()) {
+    m_out.open(m_fileName.c_str(), std::ios::out | std::ios::trunc);
+    if (!m_out.is_open()) {
+      NS_LOG_ERROR("No se pudo abrir el archivo de series de tiempo: " << m_fileName);
+      m_cantidad = 0;
+      return;
+    }
+    m_out << "Tiempo (s),Nodo,Cola MAC,Rutas,Vecinos\n";
+  }
+  // Se formatea todo el bloque en memoria y se escribe de una vez
+  std::string bloque;
+  bloque.reserve(m_cantidad * 32);
+  char linea[96];
+  for (std::size_t k = 0; k < m_cantidad; k++) {
+    const Muestra & m = m_buffer[(m_inicio + k) % m_buffer.size()];
+    int len = std::snprintf(linea, sizeof(linea), "%g,%u,%u,%u,%u\n",
+      TimeStep(m.tiempoNs).GetSeconds(), m.nodo, m.colaMac, m.rutas, m.vecinos);
+    bloque.append(linea, len);
+  }
+  m_out.write(bloque.data(), bloque.size());
+  m_inicio = (m_inicio + m_cantidad) % m_buffer.size();
+  m_cantidad = 0;
+}
+
+void TimeSeriesSampler::Cerrar(void) {
+  Volcar();
+  if (m_out.is_open()) {
+    m_out.close();
+  }
+}
+
+uint64_t TimeSeriesSampler::GetMuestras(void) const {
+  return m_muestras;
+}
+
+// Perfilador de tiempo de reloj de los callbacks del escenario y de los
+// eventos del simulador. Cada callback medido suma llamadas, tiempo total y
+// máximo en un arreglo fijo; el tiempo se lee del contador de ciclos (TSC)
+// y se convierte a segundos calibrando contra steady_clock al reportar.
+// Sin --perfilCallbacks el único costo es una comparación por callback.
+enum PuntoPerfil {
+  PERFIL_ENVIAR_NOTIFICADOR = 0,
+  PERFIL_RECIBIR_NOTIFICADOR,
+  PERFIL_RECIBIR_RESCATISTA,
+  PERFIL_CENTRAL_DESDE_RESCATISTAS,
+  PERFIL_CENTRAL_DESDE_NOTIFICADORES,
+  PERFIL_FINAL_PRINT,
+  NUM_PUNTOS_PERFIL
+};
+
+bool perfilActivo = false;
+
+inline uint64_t LeerTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+class CallbackProfiler {
+  public:
+
+    CallbackProfiler();
+
+  void Activar(void);
+  void Sumar(PuntoPerfil punto, uint64_t ticks);
+  void SumarEvento(const std::type_info * tipo, uint64_t ticks);
+  void Print(std::ostream & os) const;
+
+  private: struct Acumulado {
+    uint64_t llamadas;
+    uint64_t ticks;
+    uint64_t maximo;
+  };
+
+  static void AcumularEn(Acumulado & a, uint64_t ticks);
+
+  Acumulado m_puntos[NUM_PUNTOS_PERFIL];
+  std::unordered_map < std::type_index, Acumulado > m_eventos;
+  uint64_t m_ticksInicio;
+  std::chrono::steady_clock::time_point m_relojInicio;
+};
+
+CallbackProfiler::CallbackProfiler(): m_ticksInicio(0) {
+  std::memset(m_puntos, 0, sizeof(m_puntos));
+}
+
+void CallbackProfiler::Activar(void) {
+  // Cada escenario de un lote tiene su propio perfil
+  std::memset(m_puntos, 0, sizeof(m_puntos));
+  m_eventos.clear();
+  perfilActivo = true;
+  m_ticksInicio = LeerTicks();
+  m_relojInicio = std::chrono::steady_clock::now();
+}
+
+void CallbackProfiler::AcumularEn(Acumulado & a, uint64_t ticks) {
+  a.llamadas++;
+  a.ticks += ticks;
+  a.maximo = std::max(a.maximo, ticks);
+}
+
+void CallbackProfiler::Sumar(PuntoPerfil punto, uint64_t ticks) {
+  AcumularEn(m_puntos[punto], ticks);
+}
+
+void CallbackProfiler::SumarEvento(const std::type_info * tipo, uint64_t ticks) {
+  AcumularEn(m_eventos[std::type_index( * tipo)], ticks);
+}
+
+void CallbackProfiler::Print(std::ostream & os) const {
+  if (!perfilActivo) {
+    return;
+  }
+  // Calibración de ticks a segundos con el tiempo de reloj transcurrido
+  double reloj = std::chrono::duration < double > (std::chrono::steady_clock::now() - m_relojInicio).count();
+  uint64_t ticks = LeerTicks() - m_ticksInicio;
+  double segundosPorTick = ticks > 0 ? reloj / ticks : 0;
+
+  static const char * nombres[NUM_PUNTOS_PERFIL] = {
+    "EnviarMensajeNotificador",
+    "RecibirEnNotificadores",
+    "RecibirEnRescatista",
+    "RecibirEnCentralDesdeRescatistas",
+    "RecibirEnCentralDesdeNotificadores",
+    "FinalPrint"
+  };
+  std::vector < std::pair < std::string, Acumulado > > filas;
+  for (uint32_t i = 0; i < NUM_PUNTOS_PERFIL; i++) {
+    if (m_puntos[i].llamadas > 0) {
+      filas.push_back(std::make_pair(std::string("callback ") + nombres[i], m_puntos[i]));
+    }
+  }
+  for (const auto & par: m_eventos) {
+    // Nombre del tipo concreto de EventImpl, que identifica la clase y el
+    // método (o la función) del evento
+    int estado = 0;
+    char * nombre = abi::__cxa_demangle(par.first.name(), nullptr, nullptr, & estado);
+    filas.push_back(std::make_pair(std::string("evento ") + (estado == 0 ? nombre : par.first.name()), par.second));
+    std::free(nombre);
+  }
+  std::sort(filas.begin(), filas.end(), [](const std::pair < std::string, Acumulado > & a,
+    const std::pair < std::string, Acumulado > & b) {
+    return a.second.ticks > b.second.ticks;
+  });
+
+  os << "Perfil de tiempo de reloj (" << reloj << " s medidos; los eventos incluyen los callbacks que disparan):\n";
+  os << "  total (s)   % reloj   llamadas   promedio (us)   máximo (us)   nombre\n";
+  char linea[96];
+  for (const auto & fila: filas) {
+    const Acumulado & a = fila.second;
+    double total = a.ticks * segundosPorTick;
+    std::snprintf(linea, sizeof(linea), "  %9.4f   %7.2f   %8llu   %13.3f   %11.3f   ",
+      total, reloj > 0 ? total / reloj * 100 : 0, static_cast < unsigned long long > (a.llamadas),
+      total / a.llamadas * 1e6, a.maximo * segundosPorTick * 1e6);
+    os << linea << fila.first << "\n";
+  }
+}
+
+CallbackProfiler callbackProfiler;
+
+// Mide el tiempo de reloj de un bloque mientras el perfilador está activo
+class MedicionPerfil {
+  public:
+
+    explicit MedicionPerfil(PuntoPerfil punto): m_punto(punto),
+    m_inicio(perfilActivo ? LeerTicks() : 0) {}
+
+  ~MedicionPerfil() {
+    if (perfilActivo) {
+      callbackProfiler.Sumar(m_punto, LeerTicks() - m_inicio);
+    }
+  }
+
+  private: PuntoPerfil m_punto;
+  uint64_t m_inicio;
+};
+
+// Planificador que mide la duración de cada evento del simulador.
+// DefaultSimulatorImpl llama a RemoveNext justo antes de ejecutar cada
+// evento, así que el tiempo entre dos llamadas es el que tomó el evento
+// anterior (más el costo del planificador, que es pequeño). Los eventos se
+// agrupan por el tipo concreto de su EventImpl.
+class ProfilingScheduler: public MapScheduler {
+  public:
+
+    static TypeId GetTypeId(void);
+
+  ProfilingScheduler();
+
+  virtual Scheduler::Event RemoveNext(void);
+
+  private: const std::type_info * m_tipoAnterior;
+  uint64_t m_inicioAnterior;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ProfilingScheduler);
+
+TypeId
+ProfilingScheduler::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::ProfilingScheduler")
+    .SetParent < MapScheduler > ()
+    .AddConstructor < ProfilingScheduler > ();
+  return tid;
+}
+
+ProfilingScheduler::ProfilingScheduler(): m_tipoAnterior(nullptr),
+  m_inicioAnterior(0) {}
+
+Scheduler::Event ProfilingScheduler::RemoveNext(void) {
+  uint64_t ahora = LeerTicks();
+  if (m_tipoAnterior != nullptr) {
+    callbackProfiler.SumarEvento(m_tipoAnterior, ahora - m_inicioAnterior);
+  }
+  Scheduler::Event ev = MapScheduler::RemoveNext();
+  m_tipoAnterior = & typeid( * ev.impl);
+  m_inicioAnterior = LeerTicks();
+  return ev;
+}
+
+void ImprimirPerfil(void) {
+  callbackProfiler.Print(std::cout);
+  perfilActivo = false;
+}
+
+// Resultados por intento de las solicitudes con reintentos: cuántas veces
+// se envió el intento k, cuántas solicitudes se respondieron estando en el
+// intento k y cuántas vencieron en el intento k
+const uint32_t MAX_INTENTOS = 8;
+
+struct EstadisticasReintentos {
+  uint64_t enviados[MAX_INTENTOS];
+  uint64_t respondidos[MAX_INTENTOS];
+  uint64_t vencidos[MAX_INTENTOS];
+  uint64_t abandonadas;
+};
+
+// Escenario de rescate autocontenido: sus parámetros, los nodos e
+// interfaces, los contadores y los colectores de la corrida. Se construye,
+// se ejecuta y se descarta junto con el simulador, así varios escenarios
+// pueden correr uno tras otro en el mismo proceso sin arrastrar estado.
+// Los sumideros de traza y el registro de eventos son del proceso y cada
+// escenario los abre y cierra con sus propios archivos.
+class RescueScenario {
+  public:
+
+    explicit RescueScenario(const ScenarioConfig & cfg);
+
+  // Construye el escenario, lo simula y destruye el simulador. inicio es el
+  // instante desde el que se cuenta la preparación en el reporte de
+  // rendimiento. Devuelve el código de salida del escenario.
+  int Ejecutar(std::chrono::steady_clock::time_point inicio);
+
+  // Operaciones que usa RescueTrafficApp
+  uint32_t NuevaSolicitud(void);
+  Ipv4Address SeleccionarCentral(Ptr < Node > notificador);
+  bool EnviarMensajeNotificador(Ptr < Socket > socket, Ipv4Address dstAddr, uint32_t bytesCarga,
+    uint32_t idSolicitud, uint32_t intento);
+  void RegistrarRespondida(uint32_t intento);
+  void RegistrarVencida(uint32_t idSolicitud, uint32_t intento);
+  void RegistrarAbandono(uint32_t idSolicitud, Ipv4Address notificador);
+
+  private:
+    void Construir(void);
+  void PrepararMovilidad(uint32_t numMoviles);
+  ApplicationContainer ProgramarEnvios(void);
+  int EjecutarReplicasFork(void);
+  void AbrirTraza(const std::string & fileName);
+  void CerrarTraza(void);
+  void FinalPrint(void);
+  void WriteReportePerf(const std::string & fileName, double setupSeconds, double runSeconds);
+  void MarcarEtapa(Ptr < Packet > packet, EtapaRecorrido etapa);
+  void EnviarDesdeCentral(Ptr < Node > central, Ipv4Address destino, Ptr < Packet > packet);
+  void ProcesarEnNotificador(Ptr < Node > notificador, Ptr < Packet > packet);
+  void ProcesarEnRescatista(Ptr < Packet > packet, Ipv4Address centralSolicitud);
+
+  void RecibirEnNotificadores(Ptr < Socket > socket);
+  void RecibirEnRescatista(Ptr < Socket > socket);
+  void RecibirEnCentralDesdeRescatistas(Ptr < Socket > socket);
+  void RecibirEnCentralDesdeNotificadores(Ptr < Socket > socket);
+  void RecibirAgregado(Ptr < Socket > socket);
+
+  ScenarioConfig m_cfg;
+  PoliticaCentral m_politicaCentral;
+  PoliticaRescatista m_politicaRescatista;
+
+  // Contenedores de nodos e interfaces IPv4 de todos los nodos
+  NodeContainer m_rescatistas;
+  NodeContainer m_notificadores;
+  NodeContainer m_centrales;
+  NodeContainer m_allNodes;
+  Ipv4InterfaceContainer m_allInterfaces;
+
+  // Contadores para el resumen
+  int m_numeroIntentosComunicacion;
+  int m_comunicacionesEfectivas;
+
+  // Identificador de la siguiente solicitud enviada por un notificador
+  uint32_t m_siguienteIdSolicitud;
+
+  // Variable aleatoria para seleccionar el rescatista en el central
+  Ptr < UniformRandomVariable > m_selectorRescatista;
+  Ptr < GridWifiChannel > m_canalGrid;
+
+  ResponseTimeStats m_responseStats;
+  EstadisticasReintentos m_reintentos;
+  LegLatencyStats m_legStats;
+  IpNodeIndex m_ipIndex;
+  SocketPool m_socketPool;
+  CentralDispatcher m_centralDispatcher;
+  RescuerSelector m_rescuerSelector;
+  RoutingOverheadStats m_overheadStats;
+  TimeSeriesSampler m_timeSeriesSampler;
+  MobilityTrace m_trazaMovilidad;
+  MessageAggregator m_agregador;
+};
+
+RescueScenario::RescueScenario(const ScenarioConfig & cfg): m_cfg(cfg),
+  m_politicaCentral(CENTRAL_FIJA),
+  m_politicaRescatista(RESCATISTA_ALEATORIO),
+  m_numeroIntentosComunicacion(0),
+  m_comunicacionesEfectivas(0),
+  m_siguienteIdSolicitud(0),
+  m_reintentos() {}
+
+uint32_t RescueScenario::NuevaSolicitud(void) {
+  return m_siguienteIdSolicitud++;
+}
+
+Ipv4Address RescueScenario::SeleccionarCentral(Ptr < Node > notificador) {
+  return m_centralDispatcher.SeleccionarCentral(notificador);
+}
+
+void RescueScenario::RegistrarRespondida(uint32_t intento) {
+  m_reintentos.respondidos[intento]++;
+}
+
+void RescueScenario::RegistrarVencida(uint32_t idSolicitud, uint32_t intento) {
+  m_reintentos.vencidos[intento]++;
+  // El intento vencido deja de contar en el backlog de su central; si hay
+  // reintento vuelve a entrar al llegar a un central
+  m_centralDispatcher.Liberar(idSolicitud);
+}
+
+void RescueScenario::RegistrarAbandono(uint32_t idSolicitud, Ipv4Address notificador) {
+  m_reintentos.abandonadas++;
+  m_centralDispatcher.Liberar(idSolicitud);
+  m_responseStats.RegistrarPerdida(idSolicitud);
+  eventLog.Registrar(EVENTO_ABANDONO, idSolicitud, notificador, Ipv4Address());
+}
+
+// Agrega al paquete el instante en que pasa por la etapa
+void RescueScenario::MarcarEtapa(Ptr < Packet > packet, EtapaRecorrido etapa) {
+  if (!m_cfg.latenciaEtapas) {
+    return;
+  }
+  EtapaTag tag(etapa, Simulator::Now());
+  packet -> AddByteTag(tag);
+}
+
+// Función para imprimir los resultados de la simulación
+void RescueScenario::FinalPrint() {
+  MedicionPerfil perfil(PERFIL_FINAL_PRINT);
+  std::cout << "---------------------------------------------------------------\n";
+  std::cout << "Resumen de datos\n";
+  if (!m_cfg.nombre.empty()) {
+    std::cout << "Escenario: " << m_cfg.nombre << "\n";
+  }
+  std::cout << "Tiempo de simulación: " << m_cfg.simulationTime << " segundos \n";
+  std::cout << "Protocolo de enrutamiento usado: " << m_cfg.routingProtocol << "\n";
+  std::cout << "Número de comunicaciones efectivas: " << m_comunicacionesEfectivas << "\n";
+  std::cout << "Número de intentos de comunicaciones: " << m_numeroIntentosComunicacion << "\n";
+  std::cout << "Porcentaje de comunicaciones exitosas: " << (double) m_comunicacionesEfectivas / m_numeroIntentosComunicacion * 100 << "\n";
+  if (trazaBinaria) {
+    std::cout << "Registros escritos en " << m_cfg.CSVfileName << ": " << binaryTraceSink.GetRecordsWritten() <<
+      " (" << binaryTraceSink.GetBytesWritten() << " bytes, binario)\n";
+  } else {
+    std::cout << "Registros escritos en " << m_cfg.CSVfileName << ": " << traceSink.GetRecordsWritten() <<
+      " (" << traceSink.GetBytesWritten() << " bytes)\n";
+  }
+  std::cout << "Sockets en el pool: " << m_socketPool.GetSize() <<
+    " (aciertos: " << m_socketPool.GetHits() << ", fallos: " << m_socketPool.GetMisses() << ")\n";
+  std::cout << "Tiempo de respuesta promedio: " << m_responseStats.GetMedia() <<
+    " s (p50: " << m_responseStats.GetPercentil(0.50) <<
+    ", p95: " << m_responseStats.GetPercentil(0.95) <<
+    ", p99: " << m_responseStats.GetPercentil(0.99) << ")\n";
+  if (m_cfg.timeoutSolicitud > 0) {
+    for (uint32_t k = 0; k < m_cfg.maxIntentos && k < MAX_INTENTOS; k++) {
+      std::cout << "Intento " << k + 1 << ": enviados " << m_reintentos.enviados[k] <<
+        ", respondidos " << m_reintentos.respondidos[k] <<
+        ", vencidos " << m_reintentos.vencidos[k] << "\n";
+    }
+    std::cout << "Solicitudes abandonadas tras " << m_cfg.maxIntentos << " intentos: " <<
+      m_reintentos.abandonadas << "\n";
+  }
+  m_centralDispatcher.Print(std::cout);
+  m_agregador.Print(std::cout);
+  if (m_cfg.contabilidadOverhead) {
+    m_overheadStats.Print(std::cout);
+  }
+  if (m_cfg.intervaloMuestreo > 0) {
+    std::cout << "Muestras de series de tiempo: " << m_timeSeriesSampler.GetMuestras() << "\n";
+  }
+  if (m_cfg.latenciaEtapas) {
+    m_legStats.Print(std::cout);
+    if (!m_cfg.latenciaFileName.empty()) {
+      m_legStats.WriteCsv(m_cfg.latenciaFileName);
+    }
+  }
+  if (m_canalGrid) {
+    std::cout << "Canal espacial: rango de corte " << m_canalGrid -> GetCutoffRange() <<
+      " m, entregas: " << m_canalGrid -> GetEntregas() <<
+      ", receptores omitidos: " << m_canalGrid -> GetOmitidos() << "\n";
+  }
+  if (trazaBinaria) {
+    binaryTraceSink.Flush();
+  } else {
+    traceSink.Flush();
+  }
 
-  // Si llegamos aquí, no se encontró el nodo con la dirección IP dada
-  return nullptr;
+  // Los indicadores usan el nombre del protocolo en minúsculas, como en results/
+  std::string protocolo = m_cfg.routingProtocol;
+  std::transform(protocolo.begin(), protocolo.end(), protocolo.begin(), ::tolower);
+  m_responseStats.WriteIndicadores(m_cfg.IndicadoresFileName, protocolo);
+  if (m_cfg.contabilidadOverhead) {
+    m_overheadStats.WriteCsv(m_cfg.overheadFileName, protocolo);
+  }
 }
 
-// Envío de mensaje de Notificador -> Central
-void EnviarMensajeNotificador(Ptr < Socket > socket, Ipv4Address dstAddr, uint16_t port) {
+// Se implementa después de RescueTrafficApp
+bool NotificarRespuesta(Ptr < Node > notificador, uint32_t idSolicitud);
+
+// Envío de mensaje de Notificador -> Central. El primer intento de una
+// solicitud se registra como "request"; los reintentos, con el mismo
+// identificador, como "retry".
+bool RescueScenario::EnviarMensajeNotificador(Ptr < Socket > socket, Ipv4Address dstAddr, uint32_t bytesCarga,
+  uint32_t idSolicitud, uint32_t intento) {
+  MedicionPerfil perfil(PERFIL_ENVIAR_NOTIFICADOR);
   // Crear un paquete y añadirle datos si es necesario
-  Ptr < Packet > paquete = Create < Packet > (1000);
+  Ptr < Packet > paquete = Create < Packet > (bytesCarga);
+
+  // Obtener la dirección IP del notificador
+  Ptr < Ipv4 > ipv4 = socket -> GetNode() -> GetObject < Ipv4 > ();
+  Ipv4Address ipAddr = ipv4 -> GetAddress(1, 0).GetLocal();
+
+  // El header identifica la solicitud durante todo el recorrido
+  RescueHeader rescueHeader;
+  rescueHeader.SetNotificador(ipAddr);
+  rescueHeader.SetIdSolicitud(idSolicitud);
+  rescueHeader.SetTiempoOrigen(Simulator::Now());
+  paquete -> AddHeader(rescueHeader);
+  MarcarEtapa(paquete, ETAPA_NOTIFICADOR_ENVIA);
 
   // Enviar el paquete al nodo central
-  int bytes_enviados = socket -> SendTo(paquete, 0, InetSocketAddress(dstAddr, port));
+  int bytes_enviados = socket -> SendTo(paquete, 0, InetSocketAddress(dstAddr, PUERTO_SOLICITUDES));
 
   if (bytes_enviados > 0) {
     // NS_LOG_INFO("Se enviaron satisfactoriamente " << bytes_enviados << " bytes desde el notificador.");
     // NS_LOG_INFO("Enviado a central: " << dstAddr);
 
-    Ptr < Node > node = socket -> GetNode();
-    Ptr < Ipv4 > ipv4 = node -> GetObject < Ipv4 > ();
-    Ipv4InterfaceAddress iaddr = ipv4 -> GetAddress(1, 0);
-    Ipv4Address ipAddr = iaddr.GetLocal();
-
-    WriteCSVFile(Simulator::Now().GetSeconds(), "request", ipAddr, dstAddr,
-      bytes_enviados);
+    // En el CSV se registran los bytes de carga, sin el header de rescate
+    WriteCSVFile(Simulator::Now().GetSeconds(), intento == 0 ? "request" : "retry", ipAddr, dstAddr,
+      bytesCarga);
+    if (intento == 0) {
+      m_responseStats.RegistrarSolicitud(idSolicitud, Simulator::Now());
+    }
+    eventLog.Registrar(intento == 0 ? EVENTO_SOLICITUD : EVENTO_REINTENTO, idSolicitud, ipAddr, dstAddr);
+    if (intento < MAX_INTENTOS) {
+      m_reintentos.enviados[intento]++;
+    }
   } else {
-    NS_LOG_INFO("Error al enviar el mensaje desde el notificador. Código de error: " << socket -> GetErrno());
+    NS_LOG_PAQUETE("Error al enviar el mensaje desde el notificador. Código de error: " << socket -> GetErrno());
+    eventLog.Registrar(EVENTO_ERROR_ENVIO, idSolicitud, ipAddr, dstAddr);
+  }
+  if (intento == 0) {
+    m_numeroIntentosComunicacion++;
   }
-  numeroIntentosComunicacion++;
+  return bytes_enviados > 0;
 }
 
 // Recepción de mensaje Notificador <- Central
-void RecibirEnNotificadores(Ptr < Socket > socket) {
+void RescueScenario::RecibirEnNotificadores(Ptr < Socket > socket) {
+  MedicionPerfil perfil(PERFIL_RECIBIR_NOTIFICADOR);
   Ptr < Packet > packet;
   Address from;
   while ((packet = socket -> RecvFrom(from))) {
     if (packet -> GetSize() > 0) {
-      MyHeader NotificadorIpHeader;
-      packet -> RemoveHeader(NotificadorIpHeader);
-      // Obtener la dirección IP de destino del header
-      std::string notificadorIp = NotificadorIpHeader.GetData();
+      ProcesarEnNotificador(socket -> GetNode(), packet);
+    }
 
-      MyHeader RescatistaIpHeader;
-      packet -> RemoveHeader(RescatistaIpHeader);
-      // Obtener la dirección IP de destino del header
-      std::string rescatistaIp = RescatistaIpHeader.GetData();
+  }
 
-      // Obtener los bytes enviados para el CSV
-      uint32_t bytes_sent = packet -> GetSize();
+}
 
-      NS_LOG_INFO("Notificador con ip: " << notificadorIp << " recibe mensaje de rescatista con ip: " << rescatistaIp);
-      WriteCSVFile(Simulator::Now().GetSeconds(), "reply",
-        Ipv4Address(rescatistaIp.c_str()),
-        Ipv4Address(notificadorIp.c_str()),
-        static_cast < int > (bytes_sent));
-      comunicacionesEfectivas++;
-      // NS_LOG_INFO("--------------------------------------------------------------------------------------------");
+// Respuesta recibida por un notificador, sola o separada de un paquete
+// agregado
+void RescueScenario::ProcesarEnNotificador(Ptr < Node > notificador, Ptr < Packet > packet) {
+  RescueHeader rescueHeader;
+  packet -> RemoveHeader(rescueHeader);
+  Ipv4Address notificadorIp = rescueHeader.GetNotificador();
+  Ipv4Address rescatistaIp = rescueHeader.GetRescatista();
 
-    }
+  // Obtener los bytes enviados para el CSV
+  uint32_t bytes_sent = packet -> GetSize();
 
+  // Con reintentos pueden llegar varias respuestas a la misma
+  // solicitud, o una respuesta tardía de una solicitud abandonada: sólo
+  // cuenta la primera respuesta de una solicitud aún pendiente
+  NotificarRespuesta(notificador, rescueHeader.GetIdSolicitud());
+  if (!m_responseStats.RegistrarRespuesta(rescueHeader.GetIdSolicitud(), Simulator::Now())) {
+    return;
   }
 
+  if (m_cfg.latenciaEtapas) {
+    m_legStats.Registrar(packet, Simulator::Now());
+  }
+
+  NS_LOG_PAQUETE("Notificador con ip: " << notificadorIp << " recibe mensaje de rescatista con ip: " << rescatistaIp);
+  eventLog.Registrar(EVENTO_RESPUESTA, rescueHeader.GetIdSolicitud(), rescatistaIp, notificadorIp);
+  WriteCSVFile(Simulator::Now().GetSeconds(), "reply",
+    rescatistaIp,
+    notificadorIp,
+    static_cast < int > (bytes_sent));
+  m_comunicacionesEfectivas++;
+  // NS_LOG_INFO("--------------------------------------------------------------------------------------------");
 }
 
 // Recepción de mensaje Rescatista <- Central, y reenvío desde Rescatista -> Central
-void RecibirEnRescatista(Ptr < Socket > socket) {
+void RescueScenario::RecibirEnRescatista(Ptr < Socket > socket) {
+  MedicionPerfil perfil(PERFIL_RECIBIR_RESCATISTA);
   Ptr < Packet > packet;
   Address from;
   while ((packet = socket -> RecvFrom(from))) {
     if (packet -> GetSize() > 0) {
-      MyHeader RescatistaIpHeader;
-      packet -> RemoveHeader(RescatistaIpHeader);
-      // Obtener la dirección IP de destino del header
-      std::string rescatistaIp = RescatistaIpHeader.GetData();
-      // NS_LOG_INFO("Dirección ip del rescatista: " << rescatistaIp);
+      ProcesarEnRescatista(packet, InetSocketAddress::ConvertFrom(from).GetIpv4());
+    }
 
-      MyHeader NotificadorIpHeader;
-      packet -> RemoveHeader(NotificadorIpHeader);
-      // Obtener la dirección IP de destino del header
-      std::string notificadorIp = NotificadorIpHeader.GetData();
-      // NS_LOG_INFO("Dirección ip del notificador: " << notificadorIp);
+  }
 
-      // Convertir la dirección a InetSocketAddress
-      // InetSocketAddress address = InetSocketAddress::ConvertFrom(from);
-      // Ipv4Address senderIp = address.GetIpv4();
+}
 
-      // El rescatista ha recibido un paquete
-      // NS_LOG_INFO("Rescatista de la central " << senderIp << " recibió un mensaje: " << packet->GetSize() << " bytes");
+// Solicitud recibida por un rescatista, sola o separada de un paquete
+// agregado, y su respuesta al central
+void RescueScenario::ProcesarEnRescatista(Ptr < Packet > packet, Ipv4Address centralSolicitud) {
+  // El header ya trae la dirección del rescatista y del notificador,
+  // por lo que el rescatista lo reenvía sin modificarlo
+  RescueHeader rescueHeader;
+  packet -> PeekHeader(rescueHeader);
+  Ipv4Address rescatistaIp = rescueHeader.GetRescatista();
+  // NS_LOG_INFO("Dirección ip del rescatista: " << rescatistaIp);
 
-      Ptr < Node > node = centrales.Get(1);
-      Ptr < Ipv4 > ipv4 = node -> GetObject < Ipv4 > (); // Obtener la instancia de IPv4 asociada al nodo
-      Ipv4InterfaceAddress iaddr = ipv4 -> GetAddress(1, 0); // El índice 0 suele ser la dirección de bucle invertido
-      Ipv4Address centralAddr = iaddr.GetLocal();
+  const IpNodeIndex::Entrada * rescatista = m_ipIndex.Lookup(rescatistaIp);
+  NS_ASSERT_MSG(rescatista, "Rescatista desconocido: " << rescatistaIp);
+  m_rescuerSelector.RegistrarAtencion(rescatista -> indiceLocal);
+  MarcarEtapa(packet, ETAPA_RESCATISTA);
 
-      TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-      Ptr < Node > rescatistaNodo = FindNodeWithIpAddressInInterfaces(rescatistaIp, allInterfaces);
-      Ptr < Socket > source = Socket::CreateSocket(rescatistaNodo -> GetObject < Node > (), tid);
+  // El TTL con que llega la solicitud indica los saltos desde el central
+  // que la despachó. El tag se quita siempre: si siguiera en el paquete,
+  // IP lo usaría como TTL de salida al reenviarlo.
+  SocketIpTtlTag ttlTag;
+  if (packet -> RemovePacketTag(ttlTag)) {
+    const IpNodeIndex::Entrada * central = m_ipIndex.Lookup(centralSolicitud);
+    if (central && central -> rol == ROL_CENTRAL) {
+      m_rescuerSelector.RegistrarSaltos(central -> indiceLocal, rescatista -> indiceLocal, TTL_INICIAL - ttlTag.GetTtl() + 1);
+    }
+  }
 
-      InetSocketAddress remote = InetSocketAddress(centralAddr, 80);
-      source -> Connect(remote);
+  // El rescatista ha recibido un paquete
+  // NS_LOG_INFO("Rescatista recibió un mensaje: " << packet->GetSize() << " bytes");
 
-      // Reenviar el paquete al notificador, pasando por central
-      MyHeader ipHeaderNotificador;
-      ipHeaderNotificador.SetData(notificadorIp);
-      packet -> AddHeader(ipHeaderNotificador);
+  // La respuesta va al central que indique la política de reparto
+  Ipv4Address centralAddr = m_centralDispatcher.CentralRespuesta(centralSolicitud);
 
-      // Reenviar el paquete al central
-      source -> Send(packet);
-      // NS_LOG_INFO("Rescatista: " << rescatistaIp << " recibió de central: " << senderIp << " y envia a central " << centralAddr);
+  Ptr < Socket > source = m_socketPool.Get(rescatista -> node, centralAddr, PUERTO_RESPUESTAS);
 
-      source -> Close();
+  // Reenviar el paquete al central
+  source -> Send(packet);
+  // NS_LOG_INFO("Rescatista: " << rescatistaIp << " envia a central " << centralAddr);
+}
 
+// Recepción de un paquete agregado por un central en un rescatista o un
+// notificador: cada mensaje se procesa como si hubiera llegado solo
+void RescueScenario::RecibirAgregado(Ptr < Socket > socket) {
+  Ptr < Packet > packet;
+  Address from;
+  std::vector < Ptr < Packet > > mensajes;
+  while ((packet = socket -> RecvFrom(from))) {
+    if (packet -> GetSize() == 0) {
+      continue;
+    }
+    mensajes.clear();
+    MessageAggregator::Desagregar(packet, mensajes);
+    Ptr < Node > nodo = socket -> GetNode();
+    const IpNodeIndex::Entrada * entrada = m_ipIndex.Lookup(nodo -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal());
+    NS_ASSERT_MSG(entrada, "Nodo desconocido en la recepción de agregados");
+    for (Ptr < Packet > & mensaje: mensajes) {
+      if (entrada -> rol == ROL_RESCATISTA) {
+        MedicionPerfil perfil(PERFIL_RECIBIR_RESCATISTA);
+        ProcesarEnRescatista(mensaje, InetSocketAddress::ConvertFrom(from).GetIpv4());
+      } else {
+        MedicionPerfil perfil(PERFIL_RECIBIR_NOTIFICADOR);
+        ProcesarEnNotificador(nodo, mensaje);
+      }
     }
-
   }
+}
 
+// Envío desde un central hacia un rescatista o un notificador, directo o a
+// través de la cola de agregación
+void RescueScenario::EnviarDesdeCentral(Ptr < Node > central, Ipv4Address destino, Ptr < Packet > packet) {
+  if (m_agregador.IsActivo()) {
+    m_agregador.Encolar(central, destino, PUERTO_ENTREGAS, packet);
+    return;
+  }
+  // Obtener el socket hacia el destino desde el pool
+  m_socketPool.Get(central, destino, PUERTO_ENTREGAS) -> Send(packet);
 }
 
 // Recepción de mensaje Central <- Rescatista, y reenvío desde Central -> Notificador
-void RecibirEnCentralDesdeRescatistas(Ptr < Socket > socket) {
+void RescueScenario::RecibirEnCentralDesdeRescatistas(Ptr < Socket > socket) {
+  MedicionPerfil perfil(PERFIL_CENTRAL_DESDE_RESCATISTAS);
   Ptr < Packet > packet;
   Address from;
   while ((packet = socket -> RecvFrom(from))) {
     if (packet -> GetSize() > 0) {
 
-      MyHeader NotificadorIpHeader;
-      packet -> RemoveHeader(NotificadorIpHeader);
-      // Obtener la dirección IP de destino del header
-      std::string notificadorIp = NotificadorIpHeader.GetData();
+      RescueHeader rescueHeader;
+      packet -> PeekHeader(rescueHeader);
+      Ipv4Address notificadorIp = rescueHeader.GetNotificador();
+      // NS_LOG_INFO("Rescatista " << rescueHeader.GetRescatista() << " a notificador " << notificadorIp);
+      MarcarEtapa(packet, ETAPA_CENTRAL_RESPUESTA);
 
-      // Convertir la dirección a InetSocketAddress
-      InetSocketAddress address = InetSocketAddress::ConvertFrom(from);
-      Ipv4Address senderIp = address.GetIpv4();;
-      // NS_LOG_INFO("Rescatista " << senderIp << " a notificador " << notificadorIp);
-
-      // Crear un socket para enviar datos
-      TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-      Ptr < Socket > source = Socket::CreateSocket(centrales.Get(1) -> GetObject < Node > (), tid);
-
-      Ptr < Node > notificadorNodo = FindNodeWithIpAddressInInterfaces(notificadorIp, allInterfaces);
-      Ipv4Address notificadorAddr = notificadorNodo -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal();
-
-      InetSocketAddress remote = InetSocketAddress(notificadorAddr, 80);
-      source -> Connect(remote);
+      // El TTL con que llega la respuesta indica los saltos de la ruta
+      // actual entre el rescatista y este central
+      SocketIpTtlTag ttlTag;
+      if (packet -> RemovePacketTag(ttlTag)) {
+        const IpNodeIndex::Entrada * rescatista = m_ipIndex.Lookup(rescueHeader.GetRescatista());
+        const IpNodeIndex::Entrada * central = m_ipIndex.Lookup(socket -> GetNode() -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal());
+        if (rescatista && central) {
+          m_rescuerSelector.RegistrarSaltos(central -> indiceLocal, rescatista -> indiceLocal, TTL_INICIAL - ttlTag.GetTtl() + 1);
+        }
+      }
 
-      MyHeader ipHeaderRescatista;
-      std::stringstream ss;
-      senderIp.Print(ss);
-      ipHeaderRescatista.SetData(ss.str());
-      packet -> AddHeader(ipHeaderRescatista);
-      MyHeader ipHeaderNotificador;
-      ipHeaderNotificador.SetData(notificadorIp);
-      packet -> AddHeader(ipHeaderNotificador);
+      Ptr < Node > notificadorNodo = m_ipIndex.GetNode(notificadorIp);
+      NS_ASSERT_MSG(notificadorNodo, "Notificador desconocido: " << notificadorIp);
 
-      source -> Send(packet);
-      // NS_LOG_INFO("Central envia a notificador: " << notificadorAddr);
+      m_centralDispatcher.RegistrarSalida(rescueHeader.GetIdSolicitud());
 
-      source -> Close();
+      EnviarDesdeCentral(socket -> GetNode(), notificadorIp, packet);
+      // NS_LOG_INFO("Central envia a notificador: " << notificadorIp);
     }
   }
 }
 
 // Recepción de mensaje Central <- Notificador, y reenvío desde Central -> Rescatista
-void RecibirEnCentralDesdeNotificadores(Ptr < Socket > socket) {
+void RescueScenario::RecibirEnCentralDesdeNotificadores(Ptr < Socket > socket) {
+  MedicionPerfil perfil(PERFIL_CENTRAL_DESDE_NOTIFICADORES);
   Ptr < Packet > packet;
   Address from;
   while ((packet = socket -> RecvFrom(from))) {
     if (packet -> GetSize() > 0) {
       // Aquí el central ha recibido un paquete y ahora va a enviarlo a un rescatista
-      InetSocketAddress address = InetSocketAddress::ConvertFrom(from);
-      Ipv4Address senderIp = address.GetIpv4();
-      // NS_LOG_INFO("Central recibió un mensaje del rescatista: " << senderIp);
-      // Seleccionar un rescatista aleatorio
-      int numRescatistas = rescatistas.GetN();
-      int rescatistaAleatorioIndex = rand() % numRescatistas; // selecciona un índice aleatorio
-      Ptr < Node > rescatistaAleatorio = rescatistas.Get(rescatistaAleatorioIndex);
+      // NS_LOG_INFO("Central recibió un mensaje del notificador: " << InetSocketAddress::ConvertFrom(from).GetIpv4());
+      RescueHeader rescueHeader;
+      packet -> RemoveHeader(rescueHeader);
+      MarcarEtapa(packet, ETAPA_CENTRAL_SOLICITUD);
+
+      // Seleccionar el rescatista según la política configurada, con la
+      // tabla de saltos de este central
+      Ptr < Node > central = socket -> GetNode();
+      uint32_t indiceCentral = m_ipIndex.Lookup(central -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal()) -> indiceLocal;
+      uint32_t rescatistaIndex = m_rescuerSelector.Seleccionar(rescueHeader.GetNotificador(), indiceCentral);
+      m_rescuerSelector.RegistrarAsignacion(rescatistaIndex);
 
       // Obtener la dirección IP del rescatista
-      Ipv4Address rescatistaAddr = allInterfaces.GetAddress(numRescatistas + rescatistaAleatorioIndex);
+      Ipv4Address rescatistaAddr = m_ipIndex.GetAddress(ROL_RESCATISTA, rescatistaIndex);
+
+      // Completar el header con el rescatista asignado y reenviar
+      m_centralDispatcher.RegistrarEntrada(indiceCentral, rescueHeader.GetIdSolicitud());
+      rescueHeader.SetRescatista(rescatistaAddr);
+      packet -> AddHeader(rescueHeader);
+      eventLog.Registrar(EVENTO_ASIGNACION, rescueHeader.GetIdSolicitud(), rescueHeader.GetNotificador(), rescatistaAddr);
+      // NS_LOG_INFO("Central envia a rescatista: " << rescatistaAddr);
+      EnviarDesdeCentral(central, rescatistaAddr, packet);
+    }
+  }
+}
+
+// Abre el archivo de trazas y escribe las columnas (o el encabezado con
+// los metadatos de la corrida en la traza binaria)
+void RescueScenario::AbrirTraza(const std::string & fileName) {
+  if (!m_cfg.eventLogFileName.empty() && !eventLog.Open(m_cfg.eventLogFileName, m_cfg.eventLogTasa, m_cfg.eventLogRafaga)) {
+    NS_FATAL_ERROR("No se pudo abrir el registro de eventos: " << m_cfg.eventLogFileName);
+  }
+  trazaBinaria = m_cfg.formatoTraza == "bin";
+  if (trazaBinaria) {
+    if (!binaryTraceSink.Open(fileName)) {
+      NS_FATAL_ERROR("No se pudo abrir el archivo de trazas: " << fileName);
+    }
+    binaryTraceSink.WriteHeader(m_cfg);
+    return;
+  }
+  if (!traceSink.Open(fileName)) {
+    NS_FATAL_ERROR("No se pudo abrir el archivo CSV: " << fileName);
+  }
+  traceSink.WriteHeader();
+}
+
+void RescueScenario::CerrarTraza() {
+  traceSink.Close();
+  binaryTraceSink.Close();
+  m_timeSeriesSampler.Cerrar();
+  eventLog.Close();
+}
+
+// Inserta "-rep<i>" antes de la extensión del nombre de archivo
+std::string NombreReplica(const std::string & fileName, int replica) {
+  return NombreConSufijo(fileName, "-rep" + std::to_string(replica));
+}
+
+// Aplicación generadora de tráfico de lazo abierto para los notificadores.
+// Genera un proceso de llegadas (Poisson por defecto, de renovación con
+// cualquier distribución de interllegada, o MMPP de dos estados con
+// ráfagas) y programa sólo el siguiente envío, así la memoria no crece con
+// el número de solicitudes. Usa un único socket conectado al central.
+class RescueTrafficApp: public Application {
+  public:
+
+    static TypeId GetTypeId(void);
+
+  RescueTrafficApp();
+  virtual~RescueTrafficApp();
+
+  int64_t AssignStreams(int64_t stream);
+  uint64_t GetEnviados(void) const;
+
+  // Escenario al que pertenece el notificador
+  void SetEscenario(RescueScenario * escenario);
+
+  // Marca la solicitud como respondida; devuelve false si no estaba pendiente
+  bool RegistrarRespuesta(uint32_t idSolicitud);
+
+  protected:
+    virtual void DoDispose(void);
 
-      // Crear un socket para enviar datos
-      TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-      Ptr < Socket > source = Socket::CreateSocket(centrales.Get(0) -> GetObject < Node > (), tid);
+  private:
+    virtual void StartApplication(void);
+  virtual void StopApplication(void);
 
-      InetSocketAddress remote = InetSocketAddress(rescatistaAddr, 80);
-      source -> Connect(remote);
+  void ProgramarSiguiente(void);
+  void Enviar(void);
+  Time SiguienteInterllegada(void);
 
-      // Reenviar el paquete al rescatista
-      MyHeader ipHeaderRescatista;
-      MyHeader ipHeaderNotificador;
+  // Reintentos: tabla de solicitudes pendientes y rueda de temporizadores.
+  // Cada notificador usa un único evento (el tic de la rueda) sin importar
+  // cuántas solicitudes tenga pendientes.
+  struct Pendiente {
+    uint32_t intento;
+    uint64_t vencimiento; // en tics
+  };
 
-      std::stringstream ss;
-      rescatistaAddr.Print(ss);
-      ipHeaderRescatista.SetData(ss.str());
+  Ipv4Address Destino(void);
+  uint64_t TicActual(void) const;
+  void Armar(uint32_t idSolicitud, uint32_t intento);
+  void Tic(void);
 
-      std::stringstream ss2;
-      senderIp.Print(ss2);
-      ipHeaderNotificador.SetData(ss2.str());
+  // Atributos
+  double m_rate;
+  Time m_duration;
+  uint32_t m_payloadSize;
+  Ipv4Address m_remote;
+  uint16_t m_port;
+  Ptr < RandomVariableStream > m_interArrival;
+  Time m_timeout;
+  uint32_t m_maxIntentos;
+  double m_backoff;
+  Time m_tic;
+  double m_burstRate;
+  Time m_meanBurstTime;
+  Time m_meanIdleTime;
 
-      packet -> AddHeader(ipHeaderNotificador);
-      packet -> AddHeader(ipHeaderRescatista);
-      // NS_LOG_INFO("Central envia a rescatista: " << ss.str());
-      source -> Send(packet);
+  // Estado
+  RescueScenario * m_escenario;
+  Ptr < Socket > m_socket;
+  Ptr < ExponentialRandomVariable > m_poisson;
+  Ptr < ExponentialRandomVariable > m_burst;
+  Ptr < ExponentialRandomVariable > m_switch;
+  EventId m_sendEvent;
+  Time m_fin;
+  Time m_cambioEstado;
+  bool m_enRafaga;
+  uint64_t m_enviados;
 
-      source -> Close();
+  std::unordered_map < uint32_t, Pendiente > m_pendientes;
+  std::vector < std::vector < uint32_t > > m_rueda;
+  EventId m_ticEvent;
+  // true mientras hay un Tic programado o en ejecución: la rueda tiene una
+  // sola cadena de tics por notificador
+  bool m_ticArmado;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RescueTrafficApp);
+
+TypeId
+RescueTrafficApp::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::RescueTrafficApp")
+    .SetParent < Application > ()
+    .AddConstructor < RescueTrafficApp > ()
+    .AddAttribute("Rate",
+      "Tasa media de solicitudes por segundo (llegadas de Poisson)",
+      DoubleValue(2.0),
+      MakeDoubleAccessor( & RescueTrafficApp::m_rate),
+      MakeDoubleChecker < double > (0))
+    .AddAttribute("Duration",
+      "Tiempo durante el cual se generan solicitudes (0 = hasta detener la aplicación)",
+      TimeValue(Seconds(0)),
+      MakeTimeAccessor( & RescueTrafficApp::m_duration),
+      MakeTimeChecker())
+    .AddAttribute("PayloadSize",
+      "Bytes de carga útil de cada solicitud",
+      UintegerValue(1000),
+      MakeUintegerAccessor( & RescueTrafficApp::m_payloadSize),
+      MakeUintegerChecker < uint32_t > (1))
+    .AddAttribute("Remote",
+      "Dirección del central que recibe las solicitudes (sin asignar = la elige el escenario)",
+      Ipv4AddressValue(),
+      MakeIpv4AddressAccessor( & RescueTrafficApp::m_remote),
+      MakeIpv4AddressChecker())
+    .AddAttribute("Port",
+      "Puerto del central",
+      UintegerValue(80),
+      MakeUintegerAccessor( & RescueTrafficApp::m_port),
+      MakeUintegerChecker < uint16_t > ())
+    .AddAttribute("InterArrival",
+      "Distribución del tiempo entre llegadas en segundos (proceso de renovación). "
+      "Si no se asigna se usa una exponencial de media 1/Rate",
+      PointerValue(),
+      MakePointerAccessor( & RescueTrafficApp::m_interArrival),
+      MakePointerChecker < RandomVariableStream > ())
+    .AddAttribute("Timeout",
+      "Tiempo de espera de la respuesta al primer intento (0 = sin reintentos)",
+      TimeValue(Seconds(0)),
+      MakeTimeAccessor( & RescueTrafficApp::m_timeout),
+      MakeTimeChecker())
+    .AddAttribute("MaxAttempts",
+      "Número máximo de intentos por solicitud, incluido el primero",
+      UintegerValue(3),
+      MakeUintegerAccessor( & RescueTrafficApp::m_maxIntentos),
+      MakeUintegerChecker < uint32_t > (1, MAX_INTENTOS))
+    .AddAttribute("Backoff",
+      "Factor por el que se multiplica el tiempo de espera en cada reintento",
+      DoubleValue(2.0),
+      MakeDoubleAccessor( & RescueTrafficApp::m_backoff),
+      MakeDoubleChecker < double > (1.0))
+    .AddAttribute("TimerTick",
+      "Resolución de la rueda de temporizadores de los reintentos",
+      TimeValue(MilliSeconds(50)),
+      MakeTimeAccessor( & RescueTrafficApp::m_tic),
+      MakeTimeChecker())
+    .AddAttribute("BurstRate",
+      "Tasa de solicitudes por segundo en el estado de ráfaga del MMPP (0 = sin ráfagas)",
+      DoubleValue(0),
+      MakeDoubleAccessor( & RescueTrafficApp::m_burstRate),
+      MakeDoubleChecker < double > (0))
+    .AddAttribute("MeanBurstTime",
+      "Duración media del estado de ráfaga del MMPP",
+      TimeValue(Seconds(1)),
+      MakeTimeAccessor( & RescueTrafficApp::m_meanBurstTime),
+      MakeTimeChecker())
+    .AddAttribute("MeanIdleTime",
+      "Duración media del estado normal del MMPP",
+      TimeValue(Seconds(10)),
+      MakeTimeAccessor( & RescueTrafficApp::m_meanIdleTime),
+      MakeTimeChecker());
+  return tid;
+}
+
+RescueTrafficApp::RescueTrafficApp(): m_rate(2.0),
+  m_payloadSize(1000),
+  m_port(80),
+  m_maxIntentos(3),
+  m_backoff(2.0),
+  m_burstRate(0),
+  m_escenario(nullptr),
+  m_enRafaga(false),
+  m_enviados(0),
+  m_ticArmado(false) {
+  m_poisson = CreateObject < ExponentialRandomVariable > ();
+  m_burst = CreateObject < ExponentialRandomVariable > ();
+  m_switch = CreateObject < ExponentialRandomVariable > ();
+}
+
+RescueTrafficApp::~RescueTrafficApp() {}
+
+int64_t RescueTrafficApp::AssignStreams(int64_t stream) {
+  m_poisson -> SetStream(stream);
+  m_burst -> SetStream(stream + 1);
+  m_switch -> SetStream(stream + 2);
+  if (m_interArrival) {
+    m_interArrival -> SetStream(stream + 3);
+  }
+  return 4;
+}
+
+uint64_t RescueTrafficApp::GetEnviados(void) const {
+  return m_enviados;
+}
+
+void RescueTrafficApp::SetEscenario(RescueScenario * escenario) {
+  m_escenario = escenario;
+}
+
+void RescueTrafficApp::DoDispose(void) {
+  m_socket = nullptr;
+  m_interArrival = nullptr;
+  Application::DoDispose();
+}
+
+void RescueTrafficApp::StartApplication(void) {
+  if (!m_socket) {
+    m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+    m_socket -> Bind();
+  }
+  m_fin = m_duration.IsZero() ? Time::Max() : Simulator::Now() + m_duration;
+  m_enRafaga = false;
+  m_cambioEstado = Simulator::Now() + Seconds(m_switch -> GetValue(m_meanIdleTime.GetSeconds(), 0));
+  if (m_rate <= 0 && !m_interArrival && m_burstRate <= 0) {
+    // Sin tráfico configurado
+    return;
+  }
+  ProgramarSiguiente();
+}
+
+void RescueTrafficApp::StopApplication(void) {
+  Simulator::Cancel(m_sendEvent);
+  Simulator::Cancel(m_ticEvent);
+  m_ticArmado = false;
+  if (m_socket) {
+    m_socket -> Close();
+  }
+}
+
+Time RescueTrafficApp::SiguienteInterllegada(void) {
+  if (m_burstRate <= 0) {
+    // Proceso de renovación (Poisson si no se indicó otra distribución)
+    if (m_interArrival) {
+      return Seconds(m_interArrival -> GetValue());
+    }
+    return Seconds(m_poisson -> GetValue(1.0 / m_rate, 0));
+  }
+
+  // MMPP de dos estados: por la falta de memoria de la exponencial, si la
+  // siguiente llegada cae después del cambio de estado se avanza hasta el
+  // cambio y se vuelve a sortear con la tasa del nuevo estado
+  Time t = Simulator::Now();
+  while (true) {
+    double tasa = m_enRafaga ? m_burstRate : m_rate;
+    Time llegada = tasa > 0 ? t + Seconds(m_burst -> GetValue(1.0 / tasa, 0)) : Time::Max();
+    if (llegada <= m_cambioEstado) {
+      return llegada - Simulator::Now();
     }
+    t = m_cambioEstado;
+    m_enRafaga = !m_enRafaga;
+    Time media = m_enRafaga ? m_meanBurstTime : m_meanIdleTime;
+    m_cambioEstado = t + Seconds(m_switch -> GetValue(media.GetSeconds(), 0));
   }
 }
 
-int main(int argc, char * argv[]) {
-  // Activar NS_LOG para el componente deseado con nivel INFO
-  LogComponentEnable("AdHocRescueSimulation", LOG_LEVEL_INFO);
-  NS_LOG_INFO("Iniciando simulación");
+void RescueTrafficApp::ProgramarSiguiente(void) {
+  Time siguiente = Simulator::Now() + SiguienteInterllegada();
+  if (siguiente > m_fin) {
+    return;
+  }
+  m_sendEvent = Simulator::Schedule(siguiente - Simulator::Now(), & RescueTrafficApp::Enviar, this);
+}
+
+Ipv4Address RescueTrafficApp::Destino(void) {
+  if (m_remote == Ipv4Address()) {
+    return m_escenario -> SeleccionarCentral(GetNode());
+  }
+  return m_remote;
+}
+
+void RescueTrafficApp::Enviar(void) {
+  uint32_t idSolicitud = m_escenario -> NuevaSolicitud();
+  if (m_escenario -> EnviarMensajeNotificador(m_socket, Destino(), m_payloadSize, idSolicitud, 0) &&
+    !m_timeout.IsZero()) {
+    Armar(idSolicitud, 0);
+  }
+  m_enviados++;
+  ProgramarSiguiente();
+}
+
+// Tamaño de la rueda de temporizadores: los vencimientos más lejanos que
+// RUEDA_RANURAS tics dan más de una vuelta y se revisan en cada pasada
+static const uint32_t RUEDA_RANURAS = 256;
+
+uint64_t RescueTrafficApp::TicActual(void) const {
+  return static_cast < uint64_t > (Simulator::Now().GetTimeStep() / m_tic.GetTimeStep());
+}
+
+void RescueTrafficApp::Armar(uint32_t idSolicitud, uint32_t intento) {
+  if (m_rueda.empty()) {
+    m_rueda.resize(RUEDA_RANURAS);
+  }
+  // Espera del intento k: Timeout * Backoff^k, redondeada hacia arriba a tics
+  Time espera = Seconds(m_timeout.GetSeconds() * std::pow(m_backoff, intento));
+  uint64_t tics = std::max < uint64_t > (1, (espera.GetTimeStep() + m_tic.GetTimeStep() - 1) / m_tic.GetTimeStep());
+  Pendiente pendiente;
+  pendiente.intento = intento;
+  pendiente.vencimiento = TicActual() + tics;
+  m_pendientes[idSolicitud] = pendiente;
+  m_rueda[pendiente.vencimiento % RUEDA_RANURAS].push_back(idSolicitud);
+
+  // Dentro de Tic (reintentos) el evento en curso ya no cuenta como
+  // pendiente, por eso se usa la bandera y no m_ticEvent
+  if (!m_ticArmado) {
+    m_ticArmado = true;
+    Time siguiente = TimeStep((TicActual() + 1) * m_tic.GetTimeStep()) - Simulator::Now();
+    m_ticEvent = Simulator::Schedule(siguiente, & RescueTrafficApp::Tic, this);
+  }
+}
+
+void RescueTrafficApp::Tic(void) {
+  uint64_t ahora = TicActual();
+  std::vector < uint32_t > ranura;
+  ranura.swap(m_rueda[ahora % RUEDA_RANURAS]);
+
+  for (uint32_t idSolicitud: ranura) {
+    auto it = m_pendientes.find(idSolicitud);
+    if (it == m_pendientes.end()) {
+      // Ya respondida: se descarta de forma perezosa
+      continue;
+    }
+    if (it -> second.vencimiento > ahora) {
+      // Vence en otra vuelta de la rueda
+      m_rueda[ahora % RUEDA_RANURAS].push_back(idSolicitud);
+      continue;
+    }
+    uint32_t intento = it -> second.intento;
+    m_escenario -> RegistrarVencida(idSolicitud, intento);
+    if (intento + 1 < m_maxIntentos) {
+      // Reintento con el mismo identificador; si el envío falla la
+      // solicitud sigue pendiente y vence en el siguiente plazo
+      m_escenario -> EnviarMensajeNotificador(m_socket, Destino(), m_payloadSize, idSolicitud, intento + 1);
+      Armar(idSolicitud, intento + 1);
+    } else {
+      m_pendientes.erase(it);
+      m_escenario -> RegistrarAbandono(idSolicitud, GetNode() -> GetObject < Ipv4 > () -> GetAddress(1, 0).GetLocal());
+    }
+  }
+
+  if (m_pendientes.empty()) {
+    // Sin pendientes se detiene la rueda y se limpian las entradas viejas
+    for (auto & r: m_rueda) {
+      r.clear();
+    }
+    m_ticArmado = false;
+    return;
+  }
+  m_ticEvent = Simulator::Schedule(m_tic, & RescueTrafficApp::Tic, this);
+}
+
+bool RescueTrafficApp::RegistrarRespuesta(uint32_t idSolicitud) {
+  auto it = m_pendientes.find(idSolicitud);
+  if (it == m_pendientes.end()) {
+    return false;
+  }
+  m_escenario -> RegistrarRespondida(it -> second.intento);
+  m_pendientes.erase(it);
+  return true;
+}
+
+bool NotificarRespuesta(Ptr < Node > notificador, uint32_t idSolicitud) {
+  for (uint32_t i = 0; i < notificador -> GetNApplications(); i++) {
+    Ptr < RescueTrafficApp > app = DynamicCast < RescueTrafficApp > (notificador -> GetApplication(i));
+    if (app && app -> RegistrarRespuesta(idSolicitud)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Instala el generador de tráfico en cada notificador; el central de cada
+// solicitud lo elige m_centralDispatcher. Las aplicaciones se crean aquí para
+// que sus variables aleatorias usen la corrida (SetRun) vigente y arrancan
+// en el instante actual.
+ApplicationContainer RescueScenario::ProgramarEnvios() {
+  ApplicationContainer apps;
+  int64_t stream = STREAM_LLEGADAS;
+  for (uint32_t i = 0; i < m_notificadores.GetN(); i++) {
+    Ptr < RescueTrafficApp > app = CreateObject < RescueTrafficApp > ();
+    app -> SetAttribute("Rate", DoubleValue(m_cfg.tasaSolicitudes));
+    app -> SetAttribute("PayloadSize", UintegerValue(m_cfg.tamanoCarga));
+    app -> SetAttribute("Port", UintegerValue(PUERTO_SOLICITUDES));
+    app -> SetAttribute("Timeout", TimeValue(Seconds(m_cfg.timeoutSolicitud)));
+    app -> SetAttribute("MaxAttempts", UintegerValue(m_cfg.maxIntentos));
+    app -> SetAttribute("Backoff", DoubleValue(m_cfg.backoffReintentos));
+    app -> SetEscenario(this);
+    stream += app -> AssignStreams(stream);
+    m_notificadores.Get(i) -> AddApplication(app);
+    app -> SetStartTime(Seconds(0));
+    apps.Add(app);
+  }
+  return apps;
+}
+
+// Modo de réplicas por fork. La configuración (nodos, wifi, IP, sockets) y
+// el calentamiento hasta warmupTime se ejecutan una sola vez; luego se
+// bifurcan replicasFork procesos hijos que comparten ese estado por
+// copy-on-write. Cada hijo cambia sólo la corrida del flujo de llegadas,
+// programa su tráfico a partir de warmupTime y ejecuta la fase de medición
+// con sus propios archivos de salida. El padre espera a todos los hijos.
+int RescueScenario::EjecutarReplicasFork() {
+  NS_ABORT_MSG_IF(m_cfg.warmupTime >= m_cfg.simulationTime,
+    "warmupTime debe ser menor que el tiempo de simulación");
+
+  // Calentamiento sin tráfico de aplicación
+  Simulator::Stop(Seconds(m_cfg.warmupTime));
+  Simulator::Run();
+
+  // Vaciar los buffers antes del fork para que los hijos no los dupliquen.
+  // Las muestras del calentamiento quedan en el archivo de series base.
+  std::cout.flush();
+  std::cerr.flush();
+  m_timeSeriesSampler.Cerrar();
+
+  std::vector < pid_t > hijos;
+  for (int i = 0; i < m_cfg.replicasFork; i++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      NS_LOG_ERROR("fork() falló en la réplica " << i);
+      break;
+    }
+    if (pid == 0) {
+      // Proceso hijo: sólo las variables aleatorias creadas desde aquí (el
+      // flujo de llegadas) usan la nueva corrida; el resto conserva su estado
+      ns3::RngSeedManager::SetRun(m_cfg.run + i);
+      m_cfg.CSVfileName = NombreReplica(m_cfg.CSVfileName, i);
+      m_cfg.IndicadoresFileName = NombreReplica(m_cfg.IndicadoresFileName, i);
+      m_cfg.overheadFileName = NombreReplica(m_cfg.overheadFileName, i);
+      if (!m_cfg.eventLogFileName.empty()) {
+        m_cfg.eventLogFileName = NombreReplica(m_cfg.eventLogFileName, i);
+      }
+      m_timeSeriesSampler.SetFileName(NombreReplica(m_cfg.muestreoFileName, i));
+      AbrirTraza(m_cfg.CSVfileName);
+      if (m_cfg.perfilCallbacks) {
+        // El perfil heredado incluye el calentamiento; cada réplica mide
+        // solo su propia parte
+        callbackProfiler.Activar();
+      }
+
+      ProgramarEnvios();
+      Simulator::Schedule(Seconds(m_cfg.simulationTime - m_cfg.warmupTime), & RescueScenario::FinalPrint, this);
+      Simulator::Stop(Seconds(m_cfg.simulationTime - m_cfg.warmupTime));
+      Simulator::Run();
+
+      m_agregador.Clear();
+      m_socketPool.Clear();
+      Simulator::Destroy();
+      CerrarTraza();
+      std::cout.flush();
+      _exit(0);
+    }
+    hijos.push_back(pid);
+  }
+
+  int fallidas = 0;
+  for (pid_t pid: hijos) {
+    int status = 0;
+    if (waitpid(pid, & status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fallidas++;
+    }
+  }
+  NS_LOG_INFO("Réplicas fork terminadas: " << hijos.size() - fallidas << " de " << m_cfg.replicasFork);
+
+  m_agregador.Clear();
+  m_socketPool.Clear();
+  Simulator::Destroy();
+  return (fallidas > 0 || static_cast < int > (hijos.size()) != m_cfg.replicasFork) ? 1 : 0;
+}
+
+// Escribe las métricas de rendimiento de la corrida en formato JSON para
+// que benchmark.py las combine con el tiempo y la memoria medidos por fuera
+void RescueScenario::WriteReportePerf(const std::string & fileName, double setupSeconds, double runSeconds) {
+  std::ofstream out(fileName.c_str(), std::ios::out | std::ios::trunc);
+  if (!out.is_open()) {
+    NS_LOG_ERROR("No se pudo abrir el archivo de rendimiento: " << fileName);
+    return;
+  }
+  uint64_t eventosSimulador = Simulator::GetEventCount();
+  double tiempoSimulado = Simulator::Now().GetSeconds();
+  out << "{\"routingProtocol\": \"" << m_cfg.routingProtocol << "\", " <<
+    "\"nodes\": " << m_allNodes.GetN() << ", " <<
+    "\"events\": " << eventosSimulador << ", " <<
+    "\"setupSeconds\": " << setupSeconds << ", " <<
+    "\"runSeconds\": " << runSeconds << ", " <<
+    "\"simulatedSeconds\": " << tiempoSimulado << ", " <<
+    "\"eventsPerSecond\": " << (runSeconds > 0 ? eventosSimulador / runSeconds : 0) << ", " <<
+    "\"simSecondsPerRealSecond\": " << (runSeconds > 0 ? tiempoSimulado / runSeconds : 0) << ", " <<
+    "\"requests\": " << m_responseStats.GetSolicitudes() << ", " <<
+    "\"replies\": " << m_responseStats.GetRespuestas() << "}\n";
+}
+
+// Recorridos de la movilidad precalculada: se cargan de movilidadFileName
+// si existe; si no, se generan con la caminata aleatoria desde la malla
+// inicial y, si hay archivo, se guardan para los escenarios siguientes.
+// Un archivo generado con otra semilla, corrida, área o malla no es la
+// misma réplica y se rechaza; uno ns-2 externo solo se advierte
+void RescueScenario::PrepararMovilidad(uint32_t numMoviles) {
+  // Misma malla inicial que con RandomWalk2dMobilityModel
+  Ptr < GridPositionAllocator > malla = CreateObject < GridPositionAllocator > ();
+  malla -> SetMinX(m_cfg.posicionMinX);
+  malla -> SetMinY(m_cfg.posicionMinY);
+  malla -> SetDeltaX(m_cfg.separacionX);
+  malla -> SetDeltaY(m_cfg.separacionY);
+  malla -> SetN(m_cfg.nodosPorFila);
+  malla -> SetLayoutType(GridPositionAllocator::ROW_FIRST);
+  std::vector < Vector > iniciales;
+  for (uint32_t i = 0; i < numMoviles; i++) {
+    Vector v = malla -> GetNext();
+    // Generar recorta la posición inicial al área; se compara igual
+    v.x = std::min(std::max(v.x, -m_cfg.limiteArea), m_cfg.limiteArea);
+    v.y = std::min(std::max(v.y, -m_cfg.limiteArea), m_cfg.limiteArea);
+    iniciales.push_back(v);
+  }
+
+  const std::string & fileName = m_cfg.movilidadFileName;
+  if (!fileName.empty() && std::ifstream(fileName.c_str()).good()) {
+    std::string error;
+    if (!m_trazaMovilidad.Cargar(fileName, error)) {
+      NS_FATAL_ERROR("No se pudieron cargar los recorridos: " << error);
+    }
+    NS_ABORT_MSG_IF(m_trazaMovilidad.GetNumNodos() < numMoviles, fileName << " tiene recorridos para " <<
+      m_trazaMovilidad.GetNumNodos() << " nodos y el escenario necesita " << numMoviles);
+    std::ostringstream diferencias;
+    uint32_t seed = 0;
+    uint64_t run = 0;
+    bool conOrigen = m_trazaMovilidad.GetOrigen(seed, run);
+    if (conOrigen && (seed != RngSeedManager::GetSeed() || run != RngSeedManager::GetRun())) {
+      diferencias << " semilla/corrida " << seed << "/" << run << " en vez de " << RngSeedManager::GetSeed() <<
+        "/" << RngSeedManager::GetRun() << ";";
+    }
+    if (conOrigen ? m_trazaMovilidad.GetLimiteArea() != m_cfg.limiteArea :
+      m_trazaMovilidad.GetLimiteArea() > m_cfg.limiteArea) {
+      diferencias << " limiteArea " << m_trazaMovilidad.GetLimiteArea() << " en vez de " << m_cfg.limiteArea << ";";
+    }
+    for (uint32_t i = 0; i < numMoviles; i++) {
+      Vector p = m_trazaMovilidad.GetPosicionInicial(i);
+      // Las posiciones se guardan como float
+      if (std::abs(p.x - iniciales[i].x) > 1e-3 || std::abs(p.y - iniciales[i].y) > 1e-3) {
+        diferencias << " el nodo " << i << " empieza en (" << p.x << ", " << p.y << ") y la malla lo pone en (" <<
+          iniciales[i].x << ", " << iniciales[i].y << ");";
+        break;
+      }
+    }
+    if (!diferencias.str().empty()) {
+      if (conOrigen) {
+        NS_FATAL_ERROR("Los recorridos de " << fileName << " no corresponden a este escenario:" << diferencias.str() <<
+          " borre el archivo o use otro movilidadFileName");
+      }
+      NS_LOG_WARN("Los recorridos de " << fileName << " difieren del escenario:" << diferencias.str());
+    }
+    if (m_trazaMovilidad.GetDuracion() < m_cfg.simulationTime) {
+      NS_LOG_WARN("Los recorridos de " << fileName << " cubren " << m_trazaMovilidad.GetDuracion() <<
+        " s; después los nodos quedan quietos en su último punto");
+    }
+    NS_LOG_INFO("Recorridos cargados de " << fileName << ": " << m_trazaMovilidad.GetNumNodos() <<
+      " nodos, " << m_trazaMovilidad.GetNumPuntos() << " puntos");
+    return;
+  }
+
+  Ptr < UniformRandomVariable > aleatorio = CreateObject < UniformRandomVariable > ();
+  aleatorio -> SetStream(STREAM_MOVILIDAD);
+  m_trazaMovilidad.Generar(iniciales, m_cfg.simulationTime, m_cfg.limiteArea, aleatorio);
+  NS_LOG_INFO("Recorridos generados: " << numMoviles << " nodos, " << m_trazaMovilidad.GetNumPuntos() <<
+    " puntos (" << m_trazaMovilidad.GetNumPuntos() * sizeof(PuntoRecorrido) / 1024 << " KiB)");
 
-  // Se establece una semilla aleatoria basada en el tiempo actual
-  // Esto hará que los números generados sean diferentes en cada ejecución
-  ns3::RngSeedManager::SetSeed(std::chrono::system_clock::now().time_since_epoch().count());
+  if (!fileName.empty()) {
+    if (!m_trazaMovilidad.Guardar(fileName)) {
+      NS_FATAL_ERROR("No se pudieron guardar los recorridos en " << fileName);
+    }
+    NS_LOG_INFO("Recorridos guardados en " << fileName);
+  }
+}
 
+// Crea los nodos, la pila de internet con el protocolo de enrutamiento, el
+// wifi, las direcciones, la movilidad, los colectores y los sockets
+void RescueScenario::Construir() {
   std::string errorModelType;
   errorModelType = "ns3::YansErrorRateModel";
 
-  // Parsear argumentos de línea de comandos si los hay
-  CommandLine cmd(__FILE__);
-  //cmd.AddValue ("simulationTime", "Duracion de la simulacion", simulationTime);
-  cmd.AddValue("numNotificadores", "No. de notificadores", numNotificadores);
-  cmd.AddValue("numRescatistas", "No. de rescatistas", numRescatistas);
-  cmd.AddValue("numCentrales", "No. de nodos centrales", numCentrales);
-  cmd.AddValue("routingProtocol", "Tipo de protocolo de enrutamiento", routingProtocol);
-  cmd.AddValue("CSVfileName", "Nombre del archivo CSV", CSVfileName);
-  cmd.Parse(argc, argv);
-
-  // Escribir columnas en el archivo de salida .csv
-  std::ofstream out(CSVfileName.c_str());
-  out << "Time," <<
-    "Type," <<
-    "Source," <<
-    "Destination," <<
-    "Bytes_sent" <<
-    std::endl;
-  out.close();
+  m_selectorRescatista = CreateObject < UniformRandomVariable > ();
+  m_selectorRescatista -> SetStream(STREAM_SELECCION_RESCATISTA);
 
   // Crear los contenedores de nodos
-  notificadores.Create(numNotificadores);
-  rescatistas.Create(numRescatistas);
-  centrales.Create(numCentrales);
+  m_notificadores.Create(m_cfg.numNotificadores);
+  m_rescatistas.Create(m_cfg.numRescatistas);
+  m_centrales.Create(m_cfg.numCentrales);
 
   // Agregar todos los nodos a un contenedor
-  allNodes.Add(notificadores);
-  allNodes.Add(rescatistas);
-  allNodes.Add(centrales);
+  m_allNodes.Add(m_notificadores);
+  m_allNodes.Add(m_rescatistas);
+  m_allNodes.Add(m_centrales);
 
   // Configuración de la pila de protocolos de internet
   InternetStackHelper stack;
@@ -475,13 +4994,13 @@ int main(int argc, char * argv[]) {
   DsrMainHelper dsrMain;
 
   // Configurar el protocolo de enrutamiento
-  if (routingProtocol == "AODV") {
+  if (m_cfg.routingProtocol == "AODV") {
     AodvHelper aodv;
     stack.SetRoutingHelper(aodv);
-  } else if (routingProtocol == "OLSR") {
+  } else if (m_cfg.routingProtocol == "OLSR") {
     OlsrHelper olsr;
     stack.SetRoutingHelper(olsr);
-  } else if (routingProtocol == "DSDV") {
+  } else if (m_cfg.routingProtocol == "DSDV") {
     DsdvHelper dsdv;
     stack.SetRoutingHelper(dsdv);
   }
@@ -489,18 +5008,29 @@ int main(int argc, char * argv[]) {
   // stack.Install (notificadores);
   // stack.Install (rescatistas);
   // stack.Install (centrales);
-  stack.Install(allNodes);
+  stack.Install(m_allNodes);
 
-  if (routingProtocol == "DSR") {
-    dsrMain.Install(dsr, allNodes);
+  if (m_cfg.routingProtocol == "DSR") {
+    dsrMain.Install(dsr, m_allNodes);
   }
 
   // Configuración del canal de comunicación
   YansWifiChannelHelper wifiChannel; // = YansWifiChannelHelper::Default ();
   wifiChannel.AddPropagationLoss("ns3::FriisPropagationLossModel");
   wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-  YansWifiPhyHelper wifiPhy;
-  wifiPhy.SetChannel(wifiChannel.Create());
+  YansWifiPhyHelper yansPhy;
+  GridYansWifiPhyHelper gridPhy;
+  YansWifiPhyHelper & wifiPhy = m_cfg.canalEspacial ? gridPhy : yansPhy;
+  if (m_cfg.canalEspacial) {
+    // Canal con índice espacial: sólo entrega a receptores dentro del rango
+    m_canalGrid = CreateObject < GridWifiChannel > ();
+    m_canalGrid -> SetAttribute("CutoffRange", DoubleValue(m_cfg.rangoCorte));
+    m_canalGrid -> SetPropagationLossModel(CreateObject < FriisPropagationLossModel > ());
+    m_canalGrid -> SetPropagationDelayModel(CreateObject < ConstantSpeedPropagationDelayModel > ());
+    wifiPhy.SetChannel(m_canalGrid);
+  } else {
+    wifiPhy.SetChannel(wifiChannel.Create());
+  }
   wifiPhy.SetErrorRateModel(errorModelType);
 
   /*wifiPhy.Set ("TxPowerStart", DoubleValue (7.5));
@@ -522,9 +5052,9 @@ int main(int argc, char * argv[]) {
   // Instalar dispositivos wifi en los nodos
   NetDeviceContainer notificadorDevices, rescatistaDevices, centralDevices;
 
-  notificadorDevices = wifi.Install(wifiPhy, wifiMac, notificadores);
-  rescatistaDevices = wifi.Install(wifiPhy, wifiMac, rescatistas);
-  centralDevices = wifi.Install(wifiPhy, wifiMac, centrales);
+  notificadorDevices = wifi.Install(wifiPhy, wifiMac, m_notificadores);
+  rescatistaDevices = wifi.Install(wifiPhy, wifiMac, m_rescatistas);
+  centralDevices = wifi.Install(wifiPhy, wifiMac, m_centrales);
 
   // Agregar todos los dispositivos a un contenedor
   NetDeviceContainer allDevices;
@@ -536,7 +5066,18 @@ int main(int argc, char * argv[]) {
   Ipv4AddressHelper address;
 
   address.SetBase("10.1.0.0", "255.255.0.0"); // todos los nodos estarán en esta subred
-  allInterfaces = address.Assign(allDevices);
+  m_allInterfaces = address.Assign(allDevices);
+
+  // Construir el índice de direcciones IP -> nodo/rol
+  m_ipIndex.Clear();
+  m_ipIndex.Add(m_notificadores, ROL_NOTIFICADOR);
+  m_ipIndex.Add(m_rescatistas, ROL_RESCATISTA);
+  m_ipIndex.Add(m_centrales, ROL_CENTRAL);
+
+  // Contar el tráfico de control y de datos en IP y en el PHY de cada nodo
+  if (m_cfg.contabilidadOverhead) {
+    m_overheadStats.Instalar(m_allNodes, m_ipIndex);
+  }
 
   // Configuración de movilidad
   MobilityHelper mobility;
@@ -544,82 +5085,191 @@ int main(int argc, char * argv[]) {
   mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel"); //,
   //"Bounds",
   //RectangleValue (Rectangle (-100, 100, -100, 100)));
-  mobility.Install(centrales);
+  if (m_politicaCentral != CENTRAL_FIJA && m_cfg.numCentrales > 1) {
+    // Con reparto entre centrales se distribuyen en un círculo para que la
+    // política de central cercana tenga sentido
+    Ptr < ListPositionAllocator > posicionesCentrales = CreateObject < ListPositionAllocator > ();
+    for (int i = 0; i < m_cfg.numCentrales; i++) {
+      double angulo = 2 * M_PI * i / m_cfg.numCentrales;
+      posicionesCentrales -> Add(Vector(m_cfg.radioCentrales * std::cos(angulo), m_cfg.radioCentrales * std::sin(angulo), 0));
+    }
+    mobility.SetPositionAllocator(posicionesCentrales);
+  }
+  mobility.Install(m_centrales);
 
   mobility.SetPositionAllocator("ns3::GridPositionAllocator",
-    "MinX", DoubleValue(0.0),
-    "MinY", DoubleValue(0.0),
-    "DeltaX", DoubleValue(10.0),
-    "DeltaY", DoubleValue(20.0),
-    "GridWidth", UintegerValue(3),
+    "MinX", DoubleValue(m_cfg.posicionMinX),
+    "MinY", DoubleValue(m_cfg.posicionMinY),
+    "DeltaX", DoubleValue(m_cfg.separacionX),
+    "DeltaY", DoubleValue(m_cfg.separacionY),
+    "GridWidth", UintegerValue(m_cfg.nodosPorFila),
     "LayoutType", StringValue("RowFirst"));
 
-  mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
-    "Bounds",
-    RectangleValue(Rectangle(-100, 100, -100, 100)));
-  mobility.Install(notificadores);
-  mobility.Install(rescatistas);
+  if (m_cfg.movilidad == "precalculada") {
+    // Recorridos calculados de antemano: notificadores y luego rescatistas,
+    // en el mismo orden que en el archivo
+    NodeContainer moviles(m_notificadores, m_rescatistas);
+    PrepararMovilidad(moviles.GetN());
+    m_trazaMovilidad.Instalar(moviles, Seconds(m_cfg.intervaloMovilidad));
+  } else {
+    mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+      "Bounds",
+      RectangleValue(Rectangle(-m_cfg.limiteArea, m_cfg.limiteArea, -m_cfg.limiteArea, m_cfg.limiteArea)));
+    mobility.Install(m_notificadores);
+    mobility.Install(m_rescatistas);
+  }
+
+  // Fijar los flujos aleatorios de movilidad, wifi y enrutamiento para que
+  // no dependan del orden en que cada protocolo crea sus variables; así la
+  // misma semilla produce el mismo movimiento con AODV, OLSR o DSDV
+  mobility.AssignStreams(m_allNodes, STREAM_MOVILIDAD);
+  wifi.AssignStreams(allDevices, STREAM_WIFI);
+  stack.AssignStreams(m_allNodes, STREAM_ENRUTAMIENTO);
+
+  // Muestreo periódico del estado de la red. Con el canal espacial los
+  // vecinos se cuentan con su rango de corte.
+  if (m_cfg.intervaloMuestreo > 0) {
+    double rango = m_cfg.rangoVecinos;
+    if (rango <= 0 && m_canalGrid) {
+      rango = m_canalGrid -> GetCutoffRange();
+    }
+    m_timeSeriesSampler.SetFileName(m_cfg.muestreoFileName);
+    m_timeSeriesSampler.Configurar(m_allNodes, Seconds(m_cfg.intervaloMuestreo), rango, 1 << 16);
+  }
 
   // Crear un tipo de socket y configurarlo
   TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
 
-  // Configurar socket en nodo central para recibir mensajes
-  for (int i = 0; i < numCentrales; i++) {
-    Ptr < Node > node = centrales.Get(i);
-    Ptr < Socket > recvSocket = Socket::CreateSocket(node, tid);
+  // Configurar sockets en los nodos centrales para recibir mensajes: cada
+  // central puede recibir solicitudes y respuestas, en puertos distintos
+  for (int i = 0; i < m_cfg.numCentrales; i++) {
+    Ptr < Node > node = m_centrales.Get(i);
     Ptr < Ipv4 > ipv4 = node -> GetObject < Ipv4 > (); // Obtener la instancia de IPv4 asociada al nodo
     Ipv4InterfaceAddress iaddr = ipv4 -> GetAddress(1, 0);
-    InetSocketAddress local = InetSocketAddress(iaddr.GetLocal(), 80);
-    recvSocket -> Bind(local);
-    if (i == 0) {
-      recvSocket -> SetRecvCallback(MakeCallback( & RecibirEnCentralDesdeNotificadores));
-    } else {
-      recvSocket -> SetRecvCallback(MakeCallback( & RecibirEnCentralDesdeRescatistas));
-    }
+
+    Ptr < Socket > solicitudesSocket = Socket::CreateSocket(node, tid);
+    solicitudesSocket -> Bind(InetSocketAddress(iaddr.GetLocal(), PUERTO_SOLICITUDES));
+    solicitudesSocket -> SetRecvCallback(MakeCallback( & RescueScenario::RecibirEnCentralDesdeNotificadores, this));
+
+    Ptr < Socket > respuestasSocket = Socket::CreateSocket(node, tid);
+    respuestasSocket -> Bind(InetSocketAddress(iaddr.GetLocal(), PUERTO_RESPUESTAS));
+    respuestasSocket -> SetRecvCallback(MakeCallback( & RescueScenario::RecibirEnCentralDesdeRescatistas, this));
+    respuestasSocket -> SetIpRecvTtl(true);
+  }
+  m_centralDispatcher.Configurar(m_politicaCentral, m_centrales);
+  // Con movilidad precalculada un rescatista puede alejarse de la celda en
+  // que se lo ubicó hasta intervaloMovilidad por la velocidad máxima
+  double margenSelector = 0;
+  if (m_cfg.movilidad == "precalculada") {
+    margenSelector = m_cfg.intervaloMovilidad * m_trazaMovilidad.GetVelocidadMaxima();
   }
+  m_rescuerSelector.Configurar(m_politicaRescatista, m_rescatistas, m_centrales.GetN(), m_selectorRescatista, & m_ipIndex,
+    margenSelector);
 
   // Configurar socket en nodos rescatistas para recibir mensajes
-  for (int i = 0; i < numRescatistas; i++) {
-    Ptr < Node > node = rescatistas.Get(i);
+  for (int i = 0; i < m_cfg.numRescatistas; i++) {
+    Ptr < Node > node = m_rescatistas.Get(i);
     Ptr < Socket > recvSocket = Socket::CreateSocket(node, tid);
     Ptr < Ipv4 > ipv4 = node -> GetObject < Ipv4 > (); // Obtener la instancia de IPv4 asociada al nodo
     Ipv4InterfaceAddress iaddr = ipv4 -> GetAddress(1, 0);
-    InetSocketAddress local = InetSocketAddress(iaddr.GetLocal(), 80);
+    InetSocketAddress local = InetSocketAddress(iaddr.GetLocal(), PUERTO_ENTREGAS);
     recvSocket -> Bind(local);
-    recvSocket -> SetRecvCallback(MakeCallback( & RecibirEnRescatista));
+    recvSocket -> SetRecvCallback(MakeCallback( & RescueScenario::RecibirEnRescatista, this));
+    recvSocket -> SetIpRecvTtl(true);
   }
 
   // Configurar socket en nodos notificadores para recibir mensajes
-  for (int i = 0; i < numNotificadores; i++) {
-    Ptr < Node > node = notificadores.Get(i);
+  for (int i = 0; i < m_cfg.numNotificadores; i++) {
+    Ptr < Node > node = m_notificadores.Get(i);
     Ptr < Socket > recvSocket = Socket::CreateSocket(node, tid);
     Ptr < Ipv4 > ipv4 = node -> GetObject < Ipv4 > (); // Obtener la instancia de IPv4 asociada al nodo
     Ipv4InterfaceAddress iaddr = ipv4 -> GetAddress(1, 0);
-    InetSocketAddress local = InetSocketAddress(iaddr.GetLocal(), 80);
+    InetSocketAddress local = InetSocketAddress(iaddr.GetLocal(), PUERTO_ENTREGAS);
     recvSocket -> Bind(local);
-    recvSocket -> SetRecvCallback(MakeCallback( & RecibirEnNotificadores));
+    recvSocket -> SetRecvCallback(MakeCallback( & RescueScenario::RecibirEnNotificadores, this));
+  }
+
+  // Con agregación en los centrales, rescatistas y notificadores reciben
+  // además los paquetes agregados en su propio puerto
+  m_agregador.Configurar(Seconds(m_cfg.agregacionRetardo), m_cfg.agregacionBytes, & m_socketPool);
+  if (m_agregador.IsActivo()) {
+    NodeContainer destinos(m_rescatistas, m_notificadores);
+    for (uint32_t i = 0; i < destinos.GetN(); i++) {
+      Ptr < Node > node = destinos.Get(i);
+      Ptr < Socket > recvSocket = Socket::CreateSocket(node, tid);
+      Ipv4InterfaceAddress iaddr = node -> GetObject < Ipv4 > () -> GetAddress(1, 0);
+      recvSocket -> Bind(InetSocketAddress(iaddr.GetLocal(), PUERTO_AGREGADOS));
+      recvSocket -> SetRecvCallback(MakeCallback( & RescueScenario::RecibirAgregado, this));
+      // Los mensajes separados conservan el tag de TTL del paquete agregado
+      recvSocket -> SetIpRecvTtl(true);
+    }
   }
+}
 
-  // Crear una variable aleatoria exponencial para el tiempo de envío de mensajes
-  Ptr < ExponentialRandomVariable > x = CreateObject < ExponentialRandomVariable > ();
-  x -> SetAttribute("Mean", DoubleValue(5.0)); // La media es 5.0
+int RescueScenario::Ejecutar(std::chrono::steady_clock::time_point inicio) {
+  if (m_cfg.formatoTraza != "csv" && m_cfg.formatoTraza != "bin") {
+    NS_FATAL_ERROR("Formato de traza desconocido: " << m_cfg.formatoTraza);
+  }
+  m_cfg.CompletarNombres();
 
-  int eventos = 100;
-  // Configurar sockets en nodos notificadores para enviar mensajes
-  for (int i = 0; i < eventos; i++) {
-    Ptr < Socket > sendSocket = Socket::CreateSocket(notificadores.Get(i % numNotificadores), tid);
-    Ptr < Node > node = centrales.Get(0);
-    Ptr < Ipv4 > ipv4 = node -> GetObject < Ipv4 > ();
-    Ipv4InterfaceAddress iaddr = ipv4 -> GetAddress(1, 0);
-    // Programar el envío de mensajes para tiempo aleatorio
-    // Genera un valor aleatorio.
-    double value = x -> GetValue();
-    // NS_LOG_INFO("Mensaje eviado desde notificador: " << notificadores.Get(i % numNotificadores)->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal() <<
-    // " En el segundo: " << value);
-    Simulator::Schedule(Seconds(value), & EnviarMensajeNotificador, sendSocket, iaddr.GetLocal(), 80); // enviar a la primera dirección central
+  if (!CentralDispatcher::ParsePolitica(m_cfg.politicaCentralNombre, m_politicaCentral)) {
+    NS_FATAL_ERROR("Política de central desconocida: " << m_cfg.politicaCentralNombre);
+  }
+  if (!RescuerSelector::ParsePolitica(m_cfg.politicaRescatistaNombre, m_politicaRescatista)) {
+    NS_FATAL_ERROR("Política de rescatista desconocida: " << m_cfg.politicaRescatistaNombre);
+  }
+  if (m_cfg.movilidad != "aleatoria" && m_cfg.movilidad != "precalculada") {
+    NS_FATAL_ERROR("Movilidad desconocida: " << m_cfg.movilidad);
+  }
+  if (m_cfg.movilidad == "precalculada" && m_cfg.intervaloMovilidad <= 0) {
+    NS_FATAL_ERROR("intervaloMovilidad debe ser mayor que 0 con la movilidad precalculada");
+  }
+  // El largo de cada carga agregada se guarda en 16 bits
+  if (m_cfg.agregacionRetardo > 0 && m_cfg.agregacionBytes > 65507) {
+    NS_FATAL_ERROR("agregacionBytes no puede superar 65507 (máximo de un datagrama UDP)");
   }
 
-  Simulator::Schedule(Seconds(simulationTime), & FinalPrint);
+  // Estado global de ns-3 que sobrevive a Simulator::Destroy: las
+  // direcciones ya asignadas (el siguiente escenario vuelve a usar
+  // 10.1.0.0/16) y el contador de flujos automáticos, para que un escenario
+  // dentro de un lote dé lo mismo que corrido solo
+  Ipv4AddressGenerator::Reset();
+  ns3::RngSeedManager::ResetNextStreamIndex();
+
+  // Configurar la semilla y la corrida antes de crear cualquier variable
+  // aleatoria. Con semilla 0 se usa el tiempo actual y la ejecución no es
+  // reproducible, como en versiones anteriores.
+  if (m_cfg.seed == 0) {
+    m_cfg.seed = static_cast < uint32_t > (std::chrono::system_clock::now().time_since_epoch().count()) | 1;
+  }
+  ns3::RngSeedManager::SetSeed(m_cfg.seed);
+  ns3::RngSeedManager::SetRun(m_cfg.run);
+
+  // El planificador se cambia antes de programar cualquier evento; el
+  // simulador que se crea después de Simulator::Destroy vuelve al de
+  // por defecto
+  if (m_cfg.perfilCallbacks) {
+    ObjectFactory planificador;
+    planificador.SetTypeId("ns3::ProfilingScheduler");
+    Simulator::SetScheduler(planificador);
+    Simulator::ScheduleDestroy( & ImprimirPerfil);
+    callbackProfiler.Activar();
+  }
+
+  // Abrir el archivo de salida .csv una sola vez y escribir las columnas.
+  // En modo fork cada réplica abre su propio archivo después del fork.
+  if (m_cfg.replicasFork == 0) {
+    AbrirTraza(m_cfg.CSVfileName);
+  }
+
+  Construir();
+
+  if (m_cfg.replicasFork > 0) {
+    return EjecutarReplicasFork();
+  }
+
+  ProgramarEnvios();
+  Simulator::Schedule(Seconds(m_cfg.simulationTime), & RescueScenario::FinalPrint, this);
 
   // Imprimir todas las direcciones IP
   // for (uint32_t i = 0; i < centrales.GetN(); ++i)
@@ -634,11 +5284,162 @@ int main(int argc, char * argv[]) {
 
   // Iniciar simulación
   //Simulator::Stop (Seconds (simulationTime));
-  Simulator::Stop(Seconds(simulationTime));
+  Simulator::Stop(Seconds(m_cfg.simulationTime));
+  auto inicioRun = std::chrono::steady_clock::now();
   Simulator::Run();
+  auto finRun = std::chrono::steady_clock::now();
+
+  if (!m_cfg.perfFileName.empty()) {
+    WriteReportePerf(m_cfg.perfFileName,
+      std::chrono::duration < double > (inicioRun - inicio).count(),
+      std::chrono::duration < double > (finRun - inicioRun).count());
+  }
+
+  // Liberar los sockets reutilizados (y los mensajes que quedaron en las
+  // colas de agregación) antes de destruir los nodos
+  m_agregador.Clear();
+  m_socketPool.Clear();
 
   // TODO: Procesar los resultados de la simulación para obtener métricas
 
   Simulator::Destroy();
+  CerrarTraza();
   return 0;
 }
+
+// Quita los espacios al principio y al final
+std::string Recortar(const std::string & texto) {
+  std::size_t inicio = texto.find_first_not_of(" \t\r\n");
+  if (inicio == std::string::npos) {
+    return "";
+  }
+  std::size_t fin = texto.find_last_not_of(" \t\r\n");
+  return texto.substr(inicio, fin - inicio + 1);
+}
+
+// Lee un archivo de escenarios. Cada línea "clave = valor" usa el nombre de
+// una opción de línea de comandos; las que están antes de la primera
+// sección "[nombre]" valen para todos los escenarios, y cada sección define
+// un escenario que parte de la línea de comandos más esas claves comunes.
+// Los archivos de salida que una sección no fija llevan "-<nombre>" antes
+// de la extensión para que los escenarios no se pisen. "#" inicia un
+// comentario. Sin secciones el archivo define un único escenario.
+std::vector < ScenarioConfig > CargarEscenarios(const std::string & fileName, const ScenarioConfig & base) {
+  std::ifstream in(fileName.c_str());
+  if (!in.is_open()) {
+    NS_FATAL_ERROR("No se pudo abrir el archivo de escenarios: " << fileName);
+  }
+
+  // Argumentos "--clave=valor" de la parte común y de cada sección
+  std::vector < std::string > comunes;
+  std::vector < std::string > nombres;
+  std::vector < std::vector < std::string > > secciones;
+  std::vector < std::set < std::string > > fijados;
+  std::string linea;
+  uint32_t numeroLinea = 0;
+  while (std::getline(in, linea)) {
+    numeroLinea++;
+    linea = Recortar(linea.substr(0, linea.find('#')));
+    if (linea.empty()) {
+      continue;
+    }
+    if (linea[0] == '[') {
+      std::string nombre = linea.size() > 2 && linea.back() == ']' ? Recortar(linea.substr(1, linea.size() - 2)) : "";
+      if (nombre.empty() || std::find(nombres.begin(), nombres.end(), nombre) != nombres.end()) {
+        NS_FATAL_ERROR(fileName << ":" << numeroLinea << ": sección inválida o repetida: " << linea);
+      }
+      nombres.push_back(nombre);
+      secciones.push_back(std::vector < std::string > ());
+      fijados.push_back(std::set < std::string > ());
+      continue;
+    }
+    std::size_t igual = linea.find('=');
+    if (igual == std::string::npos || Recortar(linea.substr(0, igual)).empty()) {
+      NS_FATAL_ERROR(fileName << ":" << numeroLinea << ": se esperaba clave = valor: " << linea);
+    }
+    std::string clave = Recortar(linea.substr(0, igual));
+    std::string argumento = "--" + clave + "=" + Recortar(linea.substr(igual + 1));
+    if (secciones.empty()) {
+      comunes.push_back(argumento);
+    } else {
+      secciones.back().push_back(argumento);
+      fijados.back().insert(clave);
+    }
+  }
+  if (secciones.empty()) {
+    nombres.push_back("");
+    secciones.push_back(std::vector < std::string > ());
+    fijados.push_back(std::set < std::string > ());
+  }
+
+  // Los valores se interpretan con el mismo CommandLine que la línea de
+  // comandos, así los tipos y los errores son los mismos
+  std::vector < ScenarioConfig > escenarios;
+  for (std::size_t i = 0; i < secciones.size(); i++) {
+    ScenarioConfig escenario = base;
+    escenario.nombre = nombres[i];
+    std::vector < std::string > argumentos(1, fileName);
+    argumentos.insert(argumentos.end(), comunes.begin(), comunes.end());
+    argumentos.insert(argumentos.end(), secciones[i].begin(), secciones[i].end());
+    CommandLine cmd;
+    cmd.Usage("Escenario " + (nombres[i].empty() ? fileName : nombres[i] + " de " + fileName));
+    escenario.AgregarOpciones(cmd);
+    cmd.Parse(argumentos);
+    escenario.CompletarNombres();
+    if (!escenario.nombre.empty()) {
+      escenario.AgregarSufijo("-" + escenario.nombre, fijados[i]);
+    }
+    escenarios.push_back(escenario);
+  }
+  return escenarios;
+}
+
+int main(int argc, char * argv[]) {
+  auto inicioReloj = std::chrono::steady_clock::now();
+
+  // Parsear argumentos de línea de comandos si los hay. Con --escenarios
+  // cada escenario del archivo parte de estos valores.
+  ScenarioConfig base;
+  std::string escenariosFileName = "";
+  CommandLine cmd(__FILE__);
+  base.AgregarOpciones(cmd);
+  cmd.AddValue("verbosidad", "Nivel de log: 0 = nada, 1 = advertencias, 2 = info, 3 = por paquete", verbosidad);
+  cmd.AddValue("escenarios", "Archivo de escenarios que se ejecutan uno tras otro en este proceso", escenariosFileName);
+  cmd.Parse(argc, argv);
+
+  // Activar NS_LOG para este componente con el nivel pedido
+  static const LogLevel niveles[] = {
+    LOG_NONE,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+  };
+  if (verbosidad > 0) {
+    LogComponentEnable("AdHocRescueSimulation", niveles[std::min(verbosidad, 3)]);
+  }
+  NS_LOG_INFO("Iniciando simulación");
+
+  std::vector < ScenarioConfig > escenarios;
+  if (escenariosFileName.empty()) {
+    escenarios.push_back(base);
+  } else {
+    escenarios = CargarEscenarios(escenariosFileName, base);
+  }
+
+  // Los escenarios corren uno tras otro: el registro de tipos y módulos de
+  // ns-3 se paga una sola vez y cada escenario se destruye con el simulador
+  int resultado = 0;
+  for (std::size_t i = 0; i < escenarios.size(); i++) {
+    if (i > 0) {
+      inicioReloj = std::chrono::steady_clock::now();
+    }
+    if (!escenarios[i].nombre.empty()) {
+      NS_LOG_INFO("Escenario " << escenarios[i].nombre << " (" << i + 1 << " de " << escenarios.size() << ")");
+    }
+    RescueScenario escenario(escenarios[i]);
+    if (escenario.Ejecutar(inicioReloj) != 0) {
+      resultado = 1;
+    }
+  }
+  return resultado;
+}
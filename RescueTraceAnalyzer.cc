@@ -0,0 +1,507 @@
+// Analizador de trazas de AdHocRescueSimulation: reemplaza a
+// dataProcessing.py. Empareja cada "request" con el primer "reply" posterior
+// dirigido al mismo notificador y escribe results/<protocolo>_response.csv y
+// results/indicadores.csv con las mismas columnas.
+//
+// dataProcessing.py busca el reply de cada request con un ciclo anidado y
+// borra la fila encontrada con np.delete, así que es cuadrático. Aquí cada
+// archivo se recorre una sola vez con una cola FIFO de solicitudes
+// pendientes por notificador: el reply se asigna a la solicitud pendiente
+// más antigua de su destino, que es el mismo emparejamiento que hace el
+// ciclo anidado. Los archivos se procesan en paralelo.
+//
+// No depende de ns-3. Se compila solo:
+//   g++ -O2 -std=c++17 -pthread -o RescueTraceAnalyzer RescueTraceAnalyzer.cc
+//
+// Uso:
+//   ./RescueTraceAnalyzer                       (procesa tests/, como dataProcessing.py)
+//   ./RescueTraceAnalyzer --jobs 8 --outdir results trazas/ otra_aodv-prot_1.bin
+// El protocolo se toma del nombre del archivo como en dataProcessing.py
+// (test_<protocolo>-prot_<n>.csv). Acepta trazas CSV y binarias (.bin).
+
+#include "RescueTraceFormat.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Una llamada efectiva: tiempo de respuesta, notificador y rescatista
+struct Respuesta {
+  double tiempo;
+  uint32_t notificador;
+  uint32_t rescatista;
+};
+
+struct ResultadoArchivo {
+  std::string protocolo;
+  std::vector < Respuesta > respuestas;
+  uint64_t efectivas;
+  uint64_t realizadas;
+  double tiempoTotal;
+  std::string error;
+};
+
+// Empareja solicitudes y respuestas en una sola pasada. Las respuestas se
+// guardan por número de solicitud para devolverlas en el orden de las
+// solicitudes, como dataProcessing.py.
+class Emparejador {
+  public:
+
+    Emparejador();
+
+  void Request(double tiempo, uint32_t origen);
+  void Reply(double tiempo, uint32_t origen, uint32_t destino);
+  void Ultimo(double tiempo);
+  void Terminar(ResultadoArchivo & resultado);
+
+  private:
+    struct Pendiente {
+      uint64_t ordinal;
+      double tiempo;
+    };
+
+  std::unordered_map < uint32_t, std::deque < Pendiente > > m_pendientes;
+  std::vector < Respuesta > m_porSolicitud;
+  uint64_t m_efectivas;
+  double m_ultimo;
+};
+
+Emparejador::Emparejador(): m_efectivas(0),
+  m_ultimo(0) {}
+
+void Emparejador::Request(double tiempo, uint32_t origen) {
+  Pendiente p;
+  p.ordinal = m_porSolicitud.size();
+  p.tiempo = tiempo;
+  m_pendientes[origen].push_back(p);
+  Respuesta vacia;
+  vacia.tiempo = std::nan("");
+  vacia.notificador = origen;
+  vacia.rescatista = 0;
+  m_porSolicitud.push_back(vacia);
+}
+
+void Emparejador::Reply(double tiempo, uint32_t origen, uint32_t destino) {
+  auto it = m_pendientes.find(destino);
+  if (it == m_pendientes.end() || it -> second.empty()) {
+    return;
+  }
+  Pendiente p = it -> second.front();
+  it -> second.pop_front();
+  Respuesta & r = m_porSolicitud[p.ordinal];
+  r.tiempo = tiempo - p.tiempo;
+  r.rescatista = origen;
+  m_efectivas++;
+}
+
+void Emparejador::Ultimo(double tiempo) {
+  m_ultimo = tiempo;
+}
+
+void Emparejador::Terminar(ResultadoArchivo & resultado) {
+  resultado.respuestas.reserve(m_efectivas);
+  for (const Respuesta & r: m_porSolicitud) {
+    if (!std::isnan(r.tiempo)) {
+      resultado.respuestas.push_back(r);
+    }
+  }
+  resultado.efectivas = m_efectivas;
+  resultado.realizadas = m_porSolicitud.size();
+  resultado.tiempoTotal = m_ultimo;
+}
+
+// Convierte "a.b.c.d" en un entero de 32 bits; devuelve false si no es válida
+bool ParseIp(const char * inicio, const char * fin, uint32_t & ip) {
+  uint32_t valor = 0;
+  const char * p = inicio;
+  for (int i = 0; i < 4; i++) {
+    unsigned octeto = 0;
+    auto res = std::from_chars(p, fin, octeto);
+    if (res.ec != std::errc() || octeto > 255) {
+      return false;
+    }
+    valor = (valor << 8) | octeto;
+    p = res.ptr;
+    if (i < 3) {
+      if (p == fin || * p != '.') {
+        return false;
+      }
+      p++;
+    }
+  }
+  ip = valor;
+  return p == fin;
+}
+
+// Procesa una línea "Time,Type,Source,Destination,Bytes_sent"
+void ProcesarLinea(const char * inicio, const char * fin, Emparejador & emparejador) {
+  if (fin > inicio && fin[-1] == '\r') {
+    fin--;
+  }
+  const char * campos[5];
+  const char * finCampos[5];
+  const char * p = inicio;
+  for (int i = 0; i < 5; i++) {
+    campos[i] = p;
+    const char * coma = (i < 4) ? static_cast < const char * > (std::memchr(p, ',', fin - p)) : fin;
+    if (coma == nullptr) {
+      return;
+    }
+    finCampos[i] = coma;
+    p = coma + 1;
+  }
+  double tiempo;
+  if (std::from_chars(campos[0], finCampos[0], tiempo).ec != std::errc()) {
+    return;
+  }
+  emparejador.Ultimo(tiempo);
+  std::size_t largoTipo = finCampos[1] - campos[1];
+  uint32_t origen, destino;
+  if (!ParseIp(campos[2], finCampos[2], origen) || !ParseIp(campos[3], finCampos[3], destino)) {
+    return;
+  }
+  if (largoTipo == 7 && std::memcmp(campos[1], "request", 7) == 0) {
+    emparejador.Request(tiempo, origen);
+  } else if (largoTipo == 5 && std::memcmp(campos[1], "reply", 5) == 0) {
+    emparejador.Reply(tiempo, origen, destino);
+  }
+}
+
+// Lee el CSV por bloques de 1 MiB sin cargar el archivo completo
+bool ProcesarCsv(const std::string & fileName, Emparejador & emparejador, std::string & error) {
+  FILE * f = std::fopen(fileName.c_str(), "rb");
+  if (f == nullptr) {
+    error = "no se pudo abrir " + fileName;
+    return false;
+  }
+  std::vector < char > buffer(1 << 20);
+  std::size_t pendiente = 0;
+  bool encabezado = true;
+  while (true) {
+    if (pendiente == buffer.size()) {
+      // Línea más larga que el buffer
+      buffer.resize(buffer.size() * 2);
+    }
+    std::size_t leidos = std::fread(buffer.data() + pendiente, 1, buffer.size() - pendiente, f);
+    std::size_t total = pendiente + leidos;
+    bool finArchivo = leidos == 0;
+    const char * p = buffer.data();
+    const char * fin = buffer.data() + total;
+    while (true) {
+      const char * nl = static_cast < const char * > (std::memchr(p, '\n', fin - p));
+      if (nl == nullptr) {
+        if (finArchivo && p < fin) {
+          // Última línea sin salto de línea
+          if (!encabezado) {
+            ProcesarLinea(p, fin, emparejador);
+          }
+          p = fin;
+        }
+        break;
+      }
+      if (encabezado) {
+        encabezado = false;
+      } else {
+        ProcesarLinea(p, nl, emparejador);
+      }
+      p = nl + 1;
+    }
+    pendiente = fin - p;
+    std::memmove(buffer.data(), p, pendiente);
+    if (finArchivo) {
+      break;
+    }
+  }
+  std::fclose(f);
+  return true;
+}
+
+bool ProcesarBinario(const std::string & fileName, Emparejador & emparejador, std::string & error) {
+  BinaryTraceReader reader;
+  if (!reader.Open(fileName)) {
+    error = reader.GetError();
+    return false;
+  }
+  // Índices de "request" y "reply" en la tabla de tipos de esta traza
+  int request = -1, reply = -1;
+  for (uint32_t i = 0; i < reader.GetHeader().numTipos && i < TRAZA_MAX_TIPOS; i++) {
+    if (std::strcmp(reader.GetNombreTipo(i), "request") == 0) {
+      request = i;
+    } else if (std::strcmp(reader.GetNombreTipo(i), "reply") == 0) {
+      reply = i;
+    }
+  }
+  reader.ForEach([ & ](int64_t tiempoNs, uint8_t tipo, uint32_t src, uint32_t dst, uint16_t) {
+    double tiempo = tiempoNs / 1e9;
+    emparejador.Ultimo(tiempo);
+    if (tipo == request) {
+      emparejador.Request(tiempo, src);
+    } else if (tipo == reply) {
+      emparejador.Reply(tiempo, src, dst);
+    }
+  });
+  return true;
+}
+
+bool TerminaEn(const std::string & s, const char * sufijo) {
+  std::size_t n = std::strlen(sufijo);
+  return s.size() >= n && s.compare(s.size() - n, n, sufijo) == 0;
+}
+
+// Protocolo a partir del nombre, como en dataProcessing.py:
+// file.split("_")[1].split("-")[0]
+std::string ProtocoloDeArchivo(const std::string & path) {
+  std::string nombre = path.substr(path.find_last_of('/') + 1);
+  std::size_t a = nombre.find('_');
+  if (a == std::string::npos) {
+    return "";
+  }
+  std::size_t b = nombre.find_first_of("_", a + 1);
+  std::string parte = nombre.substr(a + 1, b == std::string::npos ? std::string::npos : b - a - 1);
+  return parte.substr(0, parte.find('-'));
+}
+
+void ProcesarArchivo(const std::string & path, ResultadoArchivo & resultado) {
+  Emparejador emparejador;
+  bool ok = TerminaEn(path, ".bin") ?
+    ProcesarBinario(path, emparejador, resultado.error) :
+    ProcesarCsv(path, emparejador, resultado.error);
+  if (ok) {
+    emparejador.Terminar(resultado);
+  }
+}
+
+// Formatea un double como str()/repr() de Python para valores entre 1e-4 y
+// 1e16: la representación más corta que se lee de vuelta igual, con ".0"
+// si es entero
+std::string FormatoPython(double x) {
+  if (std::isnan(x)) {
+    return "";
+  }
+  char buf[64];
+  auto res = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::fixed);
+  std::string s(buf, res.ptr);
+  if (s.find('.') == std::string::npos) {
+    s += ".0";
+  }
+  return s;
+}
+
+// round(x, 4) de Python
+double Redondear4(double x) {
+  if (std::isnan(x)) {
+    return x;
+  }
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.4f", x);
+  return std::strtod(buf, nullptr);
+}
+
+std::string FormatoIp(uint32_t ip) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (ip >> 24) & 0xff, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff);
+  return buf;
+}
+
+struct Grupo {
+  std::vector < const ResultadoArchivo * > archivos;
+  uint64_t efectivas = 0;
+  uint64_t realizadas = 0;
+  double tiempoTotal = 0;
+};
+
+bool EscribirRespuestas(const std::string & fileName, const Grupo & grupo) {
+  FILE * f = std::fopen(fileName.c_str(), "w");
+  if (f == nullptr) {
+    return false;
+  }
+  std::fputs("Tiempo de respuesta (s),Notificador (ip),Rescatista (ip)\n", f);
+  for (const ResultadoArchivo * r: grupo.archivos) {
+    for (const Respuesta & resp: r -> respuestas) {
+      std::fprintf(f, "%s,%s,%s\n", FormatoPython(resp.tiempo).c_str(),
+        FormatoIp(resp.notificador).c_str(), FormatoIp(resp.rescatista).c_str());
+    }
+  }
+  std::fclose(f);
+  return true;
+}
+
+// Escribe una fila de indicadores con las mismas columnas y redondeos que
+// createIndicators de dataProcessing.py (desviación y varianza muestrales)
+void EscribirIndicadores(FILE * f, const std::string & protocolo, const Grupo & grupo) {
+  std::vector < double > tiempos;
+  tiempos.reserve(grupo.efectivas);
+  for (const ResultadoArchivo * r: grupo.archivos) {
+    for (const Respuesta & resp: r -> respuestas) {
+      tiempos.push_back(resp.tiempo);
+    }
+  }
+  double nan = std::nan("");
+  double media = nan, maximo = nan, minimo = nan, mediana = nan, varianza = nan;
+  std::size_t n = tiempos.size();
+  if (n > 0) {
+    double suma = 0;
+    for (double t: tiempos) {
+      suma += t;
+    }
+    media = suma / n;
+    double m2 = 0;
+    for (double t: tiempos) {
+      m2 += (t - media) * (t - media);
+    }
+    if (n > 1) {
+      varianza = m2 / (n - 1);
+    }
+    maximo = * std::max_element(tiempos.begin(), tiempos.end());
+    minimo = * std::min_element(tiempos.begin(), tiempos.end());
+    std::nth_element(tiempos.begin(), tiempos.begin() + n / 2, tiempos.end());
+    mediana = tiempos[n / 2];
+    if (n % 2 == 0) {
+      mediana = (mediana + * std::max_element(tiempos.begin(), tiempos.begin() + n / 2)) / 2;
+    }
+  }
+  uint64_t perdidas = grupo.realizadas - grupo.efectivas;
+  double total = grupo.realizadas > 0 ? grupo.realizadas : nan;
+  std::fprintf(f, "%s,%llu,%%%s,%llu,%%%s,%llu,%s,%s,%s,%s,%s,%s,%s\n",
+    protocolo.c_str(),
+    static_cast < unsigned long long > (grupo.efectivas),
+    FormatoPython(Redondear4(grupo.efectivas / total * 100)).c_str(),
+    static_cast < unsigned long long > (perdidas),
+    FormatoPython(Redondear4(perdidas / total * 100)).c_str(),
+    static_cast < unsigned long long > (grupo.realizadas),
+    FormatoPython(Redondear4(grupo.tiempoTotal)).c_str(),
+    FormatoPython(Redondear4(media)).c_str(),
+    FormatoPython(Redondear4(maximo)).c_str(),
+    FormatoPython(Redondear4(minimo)).c_str(),
+    FormatoPython(Redondear4(mediana)).c_str(),
+    FormatoPython(Redondear4(std::sqrt(varianza))).c_str(),
+    FormatoPython(Redondear4(varianza)).c_str());
+}
+
+// Agrega los archivos de un directorio (sólo .csv y .bin) o un archivo suelto
+void AgregarEntrada(const std::string & path, std::vector < std::string > & archivos) {
+  struct stat st;
+  if (stat(path.c_str(), & st) != 0) {
+    std::cerr << "Advertencia: no existe " << path << "\n";
+    return;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    archivos.push_back(path);
+    return;
+  }
+  DIR * dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  std::vector < std::string > encontrados;
+  while (struct dirent * e = readdir(dir)) {
+    std::string nombre = e -> d_name;
+    if (TerminaEn(nombre, ".csv") || TerminaEn(nombre, ".bin")) {
+      encontrados.push_back(path + "/" + nombre);
+    }
+  }
+  closedir(dir);
+  // Orden estable entre sistemas de archivos
+  std::sort(encontrados.begin(), encontrados.end());
+  archivos.insert(archivos.end(), encontrados.begin(), encontrados.end());
+}
+
+int main(int argc, char * argv[]) {
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string outdir = "results";
+  std::vector < std::string > entradas;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--jobs" && i + 1 < argc) {
+      jobs = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--outdir" && i + 1 < argc) {
+      outdir = argv[++i];
+    } else if (arg == "-h" || arg == "--help") {
+      std::cerr << "Uso: " << argv[0] << " [--jobs N] [--outdir results] [directorio|archivo ...]\n";
+      return 0;
+    } else {
+      entradas.push_back(arg);
+    }
+  }
+  if (entradas.empty()) {
+    entradas.push_back("tests");
+  }
+
+  std::vector < std::string > archivos;
+  for (const std::string & e: entradas) {
+    AgregarEntrada(e, archivos);
+  }
+  if (archivos.empty()) {
+    std::cerr << "No hay trazas para procesar\n";
+    return 1;
+  }
+
+  // Cada hilo toma el siguiente archivo pendiente; los resultados quedan en
+  // la posición del archivo, así la salida no depende del orden de término
+  std::vector < ResultadoArchivo > resultados(archivos.size());
+  std::atomic < std::size_t > siguiente(0);
+  std::vector < std::thread > hilos;
+  for (unsigned t = 0; t < std::min < std::size_t > (jobs, archivos.size()); t++) {
+    hilos.emplace_back([ & ]() {
+      std::size_t i;
+      while ((i = siguiente++) < archivos.size()) {
+        resultados[i].protocolo = ProtocoloDeArchivo(archivos[i]);
+        ProcesarArchivo(archivos[i], resultados[i]);
+      }
+    });
+  }
+  for (std::thread & h: hilos) {
+    h.join();
+  }
+
+  std::map < std::string, Grupo > grupos;
+  int errores = 0;
+  for (std::size_t i = 0; i < archivos.size(); i++) {
+    const ResultadoArchivo & r = resultados[i];
+    if (!r.error.empty()) {
+      std::cerr << "Error: " << r.error << "\n";
+      errores++;
+      continue;
+    }
+    Grupo & g = grupos[r.protocolo];
+    g.archivos.push_back( & r);
+    g.efectivas += r.efectivas;
+    g.realizadas += r.realizadas;
+    g.tiempoTotal += r.tiempoTotal;
+  }
+
+  mkdir(outdir.c_str(), 0755);
+  FILE * indicadores = std::fopen((outdir + "/indicadores.csv").c_str(), "w");
+  if (indicadores == nullptr) {
+    std::cerr << "Error: no se pudo escribir en " << outdir << "\n";
+    return 1;
+  }
+  std::fputs("Protocolo,Llamadas efectivas,Porcentaje de llamadas efectivas,Llamadas perdidas,"
+    "Porcentaje de llamadas perdidas,Llamadas realizadas,Tiempo total de simulacion (s),"
+    "Tiempo de respuesta promedio (s),Tiempo de respuesta maximo (s),Tiempo de respuesta minimo (s),"
+    "Tiempo de respuesta - mediana (s),Tiempo de respuesta - desviacion estandar,"
+    "Tiempo de respuesta - varianza\n", indicadores);
+  for (const auto & par: grupos) {
+    if (!EscribirRespuestas(outdir + "/" + par.first + "_response.csv", par.second)) {
+      std::cerr << "Error: no se pudo escribir " << par.first << "_response.csv\n";
+      errores++;
+    }
+    EscribirIndicadores(indicadores, par.first, par.second);
+    std::cerr << par.first << ": " << par.second.archivos.size() << " archivos, " <<
+      par.second.efectivas << " de " << par.second.realizadas << " llamadas efectivas\n";
+  }
+  std::fclose(indicadores);
+  return errores ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+// Convierte una traza binaria de AdHocRescueSimulation (--formatoTraza=bin)
+// al CSV de siempre (Time,Type,Source,Destination,Bytes_sent), para que
+// dataProcessing.py y las demás herramientas sigan funcionando.
+//
+// No depende de ns-3. Se compila solo:
+//   g++ -O2 -std=c++17 -o RescueTraceToCsv RescueTraceToCsv.cc
+//
+// Uso:
+//   ./RescueTraceToCsv output-simulation.bin [output-simulation.csv]
+//   ./RescueTraceToCsv --info output-simulation.bin
+// Sin archivo de salida el CSV se escribe en la salida estándar.
+
+#include "RescueTraceFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Imprime los metadatos de la corrida guardados en el encabezado
+void ImprimirInfo(const BinaryTraceReader & reader, uint64_t registros) {
+  const BinaryTraceHeader & h = reader.GetHeader();
+  std::cerr << "Protocolo: " << h.protocolo << "\n";
+  std::cerr << "Semilla: " << h.seed << ", corrida: " << h.run << "\n";
+  std::cerr << "Notificadores: " << h.numNotificadores << ", rescatistas: " << h.numRescatistas <<
+    ", centrales: " << h.numCentrales << "\n";
+  std::cerr << "Tiempo de simulación: " << h.simulationTime << " s\n";
+  std::cerr << "Registros: " << registros;
+  if (h.numRegistros == 0) {
+    std::cerr << " (la traza no se cerró; se leyeron los bloques completos)";
+  }
+  std::cerr << "\n";
+}
+
+int main(int argc, char * argv[]) {
+  bool soloInfo = false;
+  std::vector < std::string > archivos;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--info") == 0) {
+      soloInfo = true;
+    } else {
+      archivos.push_back(argv[i]);
+    }
+  }
+  if (archivos.empty() || archivos.size() > 2) {
+    std::cerr << "Uso: " << argv[0] << " [--info] traza.bin [salida.csv]\n";
+    return 2;
+  }
+
+  BinaryTraceReader reader;
+  if (!reader.Open(archivos[0])) {
+    std::cerr << "Error: " << reader.GetError() << "\n";
+    return 1;
+  }
+
+  if (soloInfo) {
+    ImprimirInfo(reader, reader.ForEach([](int64_t, uint8_t, uint32_t, uint32_t, uint16_t) {}));
+    return 0;
+  }
+
+  FILE * out = stdout;
+  if (archivos.size() == 2) {
+    out = std::fopen(archivos[1].c_str(), "w");
+    if (out == nullptr) {
+      std::cerr << "Error: no se pudo abrir " << archivos[1] << "\n";
+      return 1;
+    }
+  }
+  // Buffer grande: la conversión está limitada por el formateo, no por el disco
+  std::vector < char > buffer(1 << 20);
+  std::setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+
+  std::fputs("Time,Type,Source,Destination,Bytes_sent\n", out);
+  // Mismo formato que CsvTraceSink::WriteRecord en el simulador
+  uint64_t registros = reader.ForEach([ & ](int64_t tiempoNs, uint8_t tipo, uint32_t src, uint32_t dst, uint16_t bytes) {
+    std::fprintf(out, "%g,%s,%u.%u.%u.%u,%u.%u.%u.%u,%u\n",
+      tiempoNs / 1e9, reader.GetNombreTipo(tipo),
+      (src >> 24) & 0xff, (src >> 16) & 0xff, (src >> 8) & 0xff, src & 0xff,
+      (dst >> 24) & 0xff, (dst >> 16) & 0xff, (dst >> 8) & 0xff, dst & 0xff,
+      static_cast < unsigned > (bytes));
+  });
+
+  if (out != stdout) {
+    std::fclose(out);
+  } else {
+    std::fflush(out);
+  }
+  ImprimirInfo(reader, registros);
+  return 0;
+}
@@ -0,0 +1,167 @@
+import argparse
+import csv
+import json
+import os
+import subprocess
+import sys
+import time
+
+# Benchmark de escalabilidad de AdHocRescueSimulation
+#
+# Ejecuta el escenario de rescate con una escalera de tamaños (número total
+# de nodos) para cada protocolo de enrutamiento y registra, por corrida:
+# tiempo de reloj, eventos procesados por segundo, memoria residente
+# máxima (RSS) y segundos simulados por segundo real. El resultado se
+# escribe como JSON y CSV para comparar contra corridas anteriores.
+#
+# Ejemplo:
+#   python benchmark.py --binary build/scratch/ns3.40-AdHocRescueSimulation-default \
+#       --sizes 12,50,200,1000,5000 --protocols AODV,OLSR,DSDV
+
+COLUMNAS = [
+    'routingProtocol',
+    'nodes',
+    'numNotificadores',
+    'numRescatistas',
+    'numCentrales',
+    'returnCode',
+    'wallSeconds',
+    'setupSeconds',
+    'runSeconds',
+    'events',
+    'eventsPerSecond',
+    'simulatedSeconds',
+    'simSecondsPerRealSecond',
+    'peakRssKiB',
+    'requests',
+    'replies'
+    ]
+
+
+def split_nodes(total, centrales):
+
+    # Reparte los nodos como en el escenario base: los centrales fijos y el
+    # resto mitad notificadores, mitad rescatistas
+    resto = max(total - centrales, 2)
+    notificadores = resto // 2
+    return notificadores, resto - notificadores
+
+
+def run_case(binary, outdir, protocol, total, centrales, timeout, extra):
+
+    notificadores, rescatistas = split_nodes(total, centrales)
+    rundir = os.path.join(outdir, '%s-%d' % (protocol.lower(), total))
+    os.makedirs(rundir, exist_ok=True)
+    perf = os.path.join(rundir, 'perf.json')
+    if os.path.exists(perf):
+        os.remove(perf)
+
+    cmd = [binary,
+           '--routingProtocol=' + protocol,
+           '--numNotificadores=%d' % notificadores,
+           '--numRescatistas=%d' % rescatistas,
+           '--numCentrales=%d' % centrales,
+           '--CSVfileName=' + os.path.join(rundir, 'output-simulation.csv'),
+           '--IndicadoresFileName=' + os.path.join(rundir, 'indicadores-simulation.csv'),
+           '--perfFileName=' + perf,
+           '--verbosidad=0'] + extra
+
+    resultado = {
+        'routingProtocol': protocol,
+        'nodes': total,
+        'numNotificadores': notificadores,
+        'numRescatistas': rescatistas,
+        'numCentrales': centrales
+        }
+
+    inicio = time.perf_counter()
+    with open(os.path.join(rundir, 'stdout.txt'), 'w') as log:
+        proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT, cwd=rundir)
+        try:
+            # wait4 devuelve el uso de recursos sólo de este hijo; ru_maxrss
+            # está en KiB en Linux
+            status, usage = wait_with_usage(proc, timeout)
+            proc.returncode = os.waitstatus_to_exitcode(status) if status is not None else -9
+        except KeyboardInterrupt:
+            proc.kill()
+            raise
+    resultado['wallSeconds'] = round(time.perf_counter() - inicio, 4)
+    resultado['returnCode'] = proc.returncode
+    resultado['peakRssKiB'] = usage.ru_maxrss if usage is not None else ''
+
+    if os.path.exists(perf):
+        with open(perf) as f:
+            datos = json.load(f)
+        for key in ['setupSeconds', 'runSeconds', 'events', 'eventsPerSecond',
+                    'simulatedSeconds', 'simSecondsPerRealSecond', 'requests', 'replies']:
+            resultado[key] = datos.get(key, '')
+
+    return resultado
+
+
+def wait_with_usage(proc, timeout):
+
+    # Devuelve (status, rusage); status es None si se agotó el tiempo
+    if timeout is None:
+        _, status, usage = os.wait4(proc.pid, 0)
+        return status, usage
+    limite = time.monotonic() + timeout
+    while True:
+        pid, status, usage = os.wait4(proc.pid, os.WNOHANG)
+        if pid != 0:
+            return status, usage
+        if time.monotonic() > limite:
+            proc.kill()
+            _, _, usage = os.wait4(proc.pid, 0)
+            return None, usage
+        time.sleep(0.05)
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description='Benchmark de escalabilidad de AdHocRescueSimulation')
+    parser.add_argument('--binary', required=True, help='Ejecutable compilado de AdHocRescueSimulation')
+    parser.add_argument('--sizes', default='12,50,200,1000,5000', help='Número total de nodos por corrida')
+    parser.add_argument('--protocols', default='AODV,OLSR,DSDV')
+    parser.add_argument('--centrales', type=int, default=2)
+    parser.add_argument('--timeout', type=float, default=None, help='Límite de tiempo por corrida (s)')
+    parser.add_argument('--outdir', default='benchmark')
+    parser.add_argument('--report', default='results/benchmark')
+    parser.add_argument('extra', nargs='*', help='Argumentos adicionales para la simulación')
+    args = parser.parse_args()
+
+    binary = os.path.abspath(args.binary)
+    outdir = os.path.abspath(args.outdir)
+    sizes = [int(x) for x in args.sizes.split(',') if x != '']
+    protocols = [x for x in args.protocols.split(',') if x != '']
+
+    # Las corridas se ejecutan de una en una para que el tiempo y la memoria
+    # medidos no se contaminen con otras corridas
+    resultados = []
+    for protocol in protocols:
+        for total in sizes:
+            resultado = run_case(binary, outdir, protocol, total, args.centrales, args.timeout, args.extra)
+            resultados.append(resultado)
+            print('%-5s %6d nodos: %8.2f s, %s eventos/s, RSS %s KiB (código %s)' % (
+                protocol, total, resultado['wallSeconds'], resultado.get('eventsPerSecond', '?'),
+                resultado['peakRssKiB'], resultado['returnCode']))
+
+    report_dir = os.path.dirname(args.report)
+    if report_dir and not os.path.exists(report_dir):
+        os.makedirs(report_dir)
+
+    with open(args.report + '.json', 'w') as f:
+        json.dump({'binary': binary, 'extra': args.extra, 'runs': resultados}, f, indent=2)
+
+    with open(args.report + '.csv', 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNAS)
+        writer.writeheader()
+        for resultado in resultados:
+            writer.writerow(resultado)
+
+    print('Reporte escrito en %s.json y %s.csv' % (args.report, args.report))
+    return 0 if all(r['returnCode'] == 0 for r in resultados) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,373 @@
+import argparse
+import csv
+import itertools
+import math
+import os
+import subprocess
+import sys
+from multiprocessing import Pool
+from statistics import mean, stdev
+
+# Barrido de replicaciones de AdHocRescueSimulation
+#
+# Ejecuta todas las combinaciones de la malla
+#   routingProtocol x numNotificadores x numRescatistas x numCentrales x semilla
+# en paralelo sobre todos los núcleos. Cada corrida escribe sus propios
+# archivos en <outdir>/<protocolo>-n<N>-r<R>-c<C>/run_<semilla>/ y al final
+# se combinan los indicadores de todas las corridas en un único resumen.
+#
+# Ejemplo:
+#   python sweep.py --binary build/scratch/ns3.40-AdHocRescueSimulation-default \
+#       --protocols AODV,OLSR,DSDV --seeds 1-5 --jobs 64
+#
+# Con --target-success o --target-response el número de replicaciones no es
+# fijo: las semillas de --seeds son las replicaciones iniciales y se siguen
+# lanzando replicaciones de cada configuración hasta que el semiancho del
+# intervalo de confianza del porcentaje de llamadas efectivas y del tiempo
+# de respuesta promedio baja del objetivo (o se llega a --max-reps).
+
+COLUMNAS_INDICADORES = [
+    'Protocolo',
+    'Llamadas efectivas',
+    'Porcentaje de llamadas efectivas',
+    'Llamadas perdidas',
+    'Porcentaje de llamadas perdidas',
+    'Llamadas realizadas',
+    'Tiempo total de simulacion (s)',
+    'Tiempo de respuesta promedio (s)',
+    'Tiempo de respuesta maximo (s)',
+    'Tiempo de respuesta minimo (s)',
+    'Tiempo de respuesta - mediana (s)',
+    'Tiempo de respuesta - desviacion estandar',
+    'Tiempo de respuesta - varianza',
+    'Tiempo de respuesta - p95 (s)',
+    'Tiempo de respuesta - p99 (s)'
+    ]
+
+COLUMNAS_CONFIGURACION = ['numNotificadores', 'numRescatistas', 'numCentrales', 'Replicaciones']
+
+COLUMNAS_PRECISION = [
+    'Nivel de confianza',
+    'Semiancho IC llamadas efectivas (pp)',
+    'Semiancho IC tiempo de respuesta (s)',
+    'Convergencia'
+    ]
+
+
+def parse_list(text, cast=str):
+
+    return [cast(x) for x in text.split(',') if x != '']
+
+
+def parse_seeds(text):
+
+    # Acepta "1,2,3", "1-5" o una combinación "1-5,10"
+    seeds = []
+    for part in text.split(','):
+        if '-' in part:
+            lo, hi = part.split('-')
+            seeds.extend(range(int(lo), int(hi) + 1))
+        elif part != '':
+            seeds.append(int(part))
+    return seeds
+
+
+def run_directory(outdir, protocol, n, r, c):
+
+    return os.path.join(outdir, '%s-n%d-r%d-c%d' % (protocol.lower(), n, r, c))
+
+
+def run_single(job):
+
+    binary, outdir, protocol, n, r, c, seed, extra = job
+
+    rundir = os.path.join(run_directory(outdir, protocol, n, r, c), 'run_%d' % seed)
+    os.makedirs(rundir, exist_ok=True)
+
+    trace = os.path.join(rundir, 'output-simulation.csv')
+    indicators = os.path.join(rundir, 'indicadores-simulation.csv')
+
+    # La semilla de la malla se usa como número de corrida (--run) con una
+    # semilla base fija, así cada corrida usa subflujos independientes y el
+    # mismo seed produce la misma corrida en cualquier máquina
+    cmd = [binary,
+           '--routingProtocol=' + protocol,
+           '--numNotificadores=%d' % n,
+           '--numRescatistas=%d' % r,
+           '--numCentrales=%d' % c,
+           '--CSVfileName=' + trace,
+           '--IndicadoresFileName=' + indicators,
+           '--seed=1',
+           '--run=%d' % seed,
+           '--verbosidad=0'] + extra
+
+    with open(os.path.join(rundir, 'stdout.txt'), 'w') as log:
+        result = subprocess.run(cmd, stdout=log, stderr=subprocess.STDOUT, cwd=rundir)
+
+    return (protocol, n, r, c, seed, result.returncode, indicators)
+
+
+def read_indicators(file_path):
+
+    with open(file_path, newline='') as f:
+        rows = list(csv.DictReader(f))
+    return rows[0] if rows else None
+
+
+def combine_indicators(rows):
+
+    # Combina los indicadores de varias corridas. Conteos, mínimos y máximos
+    # son exactos; media y varianza se combinan con la fórmula de Chan para
+    # varianzas agrupadas. Los percentiles no se pueden combinar de forma
+    # exacta y se aproximan con el promedio ponderado por número de respuestas.
+    efectivas = 0
+    realizadas = 0
+    tiempoTotal = 0.0
+    media = 0.0
+    m2 = 0.0
+    minimo = math.inf
+    maximo = -math.inf
+    percentiles = {'Tiempo de respuesta - mediana (s)': 0.0,
+                   'Tiempo de respuesta - p95 (s)': 0.0,
+                   'Tiempo de respuesta - p99 (s)': 0.0}
+
+    for row in rows:
+        nb = int(row['Llamadas efectivas'])
+        realizadas += int(row['Llamadas realizadas'])
+        tiempoTotal += float(row['Tiempo total de simulacion (s)'])
+        if nb == 0:
+            continue
+        mb = float(row['Tiempo de respuesta promedio (s)'])
+        m2b = float(row['Tiempo de respuesta - varianza']) * (nb - 1)
+        na = efectivas
+        n = na + nb
+        delta = mb - media
+        media += delta * nb / n
+        m2 += m2b + delta * delta * na * nb / n
+        efectivas = n
+        minimo = min(minimo, float(row['Tiempo de respuesta minimo (s)']))
+        maximo = max(maximo, float(row['Tiempo de respuesta maximo (s)']))
+        for key in percentiles:
+            percentiles[key] += float(row[key]) * nb
+
+    perdidas = realizadas - efectivas
+    varianza = m2 / (efectivas - 1) if efectivas > 1 else 0.0
+    total = realizadas if realizadas > 0 else 1
+
+    resultado = {
+        'Llamadas efectivas': efectivas,
+        'Porcentaje de llamadas efectivas': '%' + str(round(efectivas / total * 100, 4)),
+        'Llamadas perdidas': perdidas,
+        'Porcentaje de llamadas perdidas': '%' + str(round(perdidas / total * 100, 4)),
+        'Llamadas realizadas': realizadas,
+        'Tiempo total de simulacion (s)': round(tiempoTotal, 4),
+        'Tiempo de respuesta promedio (s)': round(media, 4),
+        'Tiempo de respuesta maximo (s)': round(maximo, 4) if efectivas else 0,
+        'Tiempo de respuesta minimo (s)': round(minimo, 4) if efectivas else 0,
+        'Tiempo de respuesta - desviacion estandar': round(math.sqrt(varianza), 4),
+        'Tiempo de respuesta - varianza': round(varianza, 4)
+        }
+    for key, value in percentiles.items():
+        resultado[key] = round(value / efectivas, 4) if efectivas else 0
+
+    return resultado
+
+
+def t_cdf(t, df):
+
+    # Distribución t de Student con df entero en forma cerrada (Abramowitz y
+    # Stegun 26.7.3 y 26.7.4): P(|T| < t) es una suma finita de potencias de
+    # cos(theta), con theta = atan(t / sqrt(df))
+    theta = math.atan(t / math.sqrt(df))
+    cos2 = math.cos(theta) ** 2
+    if df % 2:
+        suma = 0.0
+        termino = math.cos(theta)
+        for k in range(1, (df - 1) // 2 + 1):
+            if k > 1:
+                termino *= cos2 * (2 * k - 2) / (2 * k - 1)
+            suma += termino
+        dentro = 2 / math.pi * (theta + math.sin(theta) * suma)
+    else:
+        suma = 1.0
+        termino = 1.0
+        for k in range(1, df // 2):
+            termino *= cos2 * (2 * k - 1) / (2 * k)
+            suma += termino
+        dentro = math.sin(theta) * suma
+    return (1 + dentro) / 2
+
+
+def t_quantile(p, df):
+
+    # Cuantil exacto de la t de Student por bisección sobre t_cdf; la
+    # aproximación normal se queda corta justo con pocas replicaciones
+    lo, hi = 0.0, 1.0
+    while t_cdf(hi, df) < p:
+        hi *= 2
+    for _ in range(100):
+        medio = (lo + hi) / 2
+        if t_cdf(medio, df) < p:
+            lo = medio
+        else:
+            hi = medio
+    return hi
+
+
+def half_width(values, confianza):
+
+    # Semiancho del intervalo de confianza de la media de replicaciones
+    # independientes; None si no hay suficientes para estimarlo
+    n = len(values)
+    if n < 2:
+        return None
+    return t_quantile(1 - (1 - confianza) / 2, n - 1) * stdev(values) / math.sqrt(n)
+
+
+def precision(rows, confianza):
+
+    # Cada replicación aporta una observación de cada indicador: su
+    # porcentaje de llamadas efectivas y su tiempo de respuesta promedio
+    exito = [100.0 * int(r['Llamadas efectivas']) / int(r['Llamadas realizadas'])
+             for r in rows if int(r['Llamadas realizadas']) > 0]
+    respuesta = [float(r['Tiempo de respuesta promedio (s)'])
+                 for r in rows if int(r['Llamadas efectivas']) > 0]
+    return (half_width(exito, confianza), half_width(respuesta, confianza),
+            mean(respuesta) if respuesta else 0.0)
+
+
+def replicas_necesarias(rows, args):
+
+    # Replicaciones totales que se estiman necesarias para alcanzar los
+    # objetivos (len(rows) si ya se alcanzaron). El semiancho decrece como
+    # 1/sqrt(n), así que se estima n * (h / objetivo)^2.
+    n = len(rows)
+    hExito, hRespuesta, mediaRespuesta = precision(rows, args.confidence)
+    necesarias = n
+    if args.target_success is not None:
+        if hExito is None:
+            necesarias = max(necesarias, n + 1)
+        elif hExito > args.target_success:
+            necesarias = max(necesarias, math.ceil(n * (hExito / args.target_success) ** 2))
+    if args.target_response is not None and mediaRespuesta > 0:
+        objetivo = args.target_response * mediaRespuesta
+        if hRespuesta is None:
+            necesarias = max(necesarias, n + 1)
+        elif hRespuesta > objetivo:
+            necesarias = max(necesarias, math.ceil(n * (hRespuesta / objetivo) ** 2))
+    return necesarias
+
+
+def replicas_faltantes(rows, args):
+
+    # Replicaciones a lanzar en la siguiente ronda; como las primeras
+    # estimaciones son ruidosas, se agregan como mucho tantas como ya hay
+    n = len(rows)
+    return max(min(replicas_necesarias(rows, args), args.max_reps, 2 * n) - n, 0)
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description='Barrido paralelo de AdHocRescueSimulation')
+    parser.add_argument('--binary', required=True, help='Ejecutable compilado de AdHocRescueSimulation')
+    parser.add_argument('--protocols', default='AODV,OLSR,DSDV')
+    parser.add_argument('--notificadores', default='5')
+    parser.add_argument('--rescatistas', default='5')
+    parser.add_argument('--centrales', default='2')
+    parser.add_argument('--seeds', default='1-5')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count())
+    parser.add_argument('--outdir', default='sweep')
+    parser.add_argument('--summary', default='results/indicadores_sweep.csv')
+    parser.add_argument('--target-success', type=float, default=None,
+                        help='Semiancho objetivo del IC del porcentaje de llamadas efectivas (puntos porcentuales)')
+    parser.add_argument('--target-response', type=float, default=None,
+                        help='Semiancho objetivo del IC del tiempo de respuesta promedio, relativo a la media (0.05 = 5 %%)')
+    parser.add_argument('--confidence', type=float, default=0.95)
+    parser.add_argument('--max-reps', type=int, default=50, help='Máximo de replicaciones por configuración')
+    parser.add_argument('extra', nargs='*', help='Argumentos adicionales para la simulación')
+    args = parser.parse_args()
+
+    binary = os.path.abspath(args.binary)
+    outdir = os.path.abspath(args.outdir)
+
+    secuencial = args.target_success is not None or args.target_response is not None
+    seeds = parse_seeds(args.seeds)
+    if secuencial and len(seeds) < 3:
+        parser.error('el modo secuencial necesita al menos 3 replicaciones iniciales en --seeds')
+
+    configuraciones = list(itertools.product(
+        parse_list(args.protocols),
+        parse_list(args.notificadores, int),
+        parse_list(args.rescatistas, int),
+        parse_list(args.centrales, int)))
+    jobs = [(binary, outdir, p, n, r, c, s, args.extra) for (p, n, r, c) in configuraciones for s in seeds]
+
+    grupos = {}
+    fallidas = 0
+    lanzadas = 0
+    siguiente = {config: max(seeds) + 1 for config in configuraciones}
+    # Las corridas fallidas también cuentan para --max-reps, para que una
+    # configuración que siempre falla no se relance sin fin
+    lanzadasPor = {config: len(seeds) for config in configuraciones}
+    with Pool(processes=args.jobs) as pool:
+        ronda = 1
+        while jobs:
+            # imap_unordered con chunksize=1 reparte las corridas de una en
+            # una: un proceso libre toma la siguiente corrida pendiente, así
+            # las corridas largas (muchos nodos, OLSR) no dejan núcleos ociosos
+            for done, (p, n, r, c, s, code, indicators) in enumerate(pool.imap_unordered(run_single, jobs, chunksize=1), 1):
+                if code != 0 or not os.path.exists(indicators):
+                    fallidas += 1
+                    print('[%d/%d] %s n=%d r=%d c=%d seed=%d FALLÓ (código %d)' % (done, len(jobs), p, n, r, c, s, code), file=sys.stderr)
+                    continue
+                row = read_indicators(indicators)
+                if row is not None:
+                    grupos.setdefault((p, n, r, c), []).append(row)
+                print('[%d/%d] %s n=%d r=%d c=%d seed=%d' % (done, len(jobs), p, n, r, c, s))
+            lanzadas += len(jobs)
+            if not secuencial:
+                break
+
+            # Siguiente ronda: sólo las configuraciones que no alcanzaron la
+            # precisión, con semillas nuevas a continuación de las usadas
+            jobs = []
+            for config in configuraciones:
+                faltan = min(replicas_faltantes(grupos.get(config, []), args), args.max_reps - lanzadasPor[config])
+                p, n, r, c = config
+                for s in range(siguiente[config], siguiente[config] + faltan):
+                    jobs.append((binary, outdir, p, n, r, c, s, args.extra))
+                siguiente[config] += faltan
+                lanzadasPor[config] += faltan
+            ronda += 1
+            if jobs:
+                print('Ronda %d: %d replicaciones más para %d configuraciones sin converger' % (
+                    ronda, len(jobs), len(set(j[2:6] for j in jobs))))
+
+    summary_dir = os.path.dirname(args.summary)
+    if summary_dir and not os.path.exists(summary_dir):
+        os.makedirs(summary_dir)
+
+    with open(args.summary, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNAS_INDICADORES + COLUMNAS_CONFIGURACION + COLUMNAS_PRECISION)
+        writer.writeheader()
+        for (p, n, r, c), rows in sorted(grupos.items()):
+            resultado = combine_indicators(rows)
+            hExito, hRespuesta, _ = precision(rows, args.confidence)
+            resultado.update({
+                'Protocolo': p.lower(),
+                'numNotificadores': n,
+                'numRescatistas': r,
+                'numCentrales': c,
+                'Replicaciones': len(rows),
+                'Nivel de confianza': args.confidence,
+                'Semiancho IC llamadas efectivas (pp)': round(hExito, 4) if hExito is not None else '',
+                'Semiancho IC tiempo de respuesta (s)': round(hRespuesta, 4) if hRespuesta is not None else '',
+                'Convergencia': ('si' if replicas_necesarias(rows, args) <= len(rows) else 'no') if secuencial else ''})
+            writer.writerow(resultado)
+
+    print('Resumen escrito en %s (%d corridas, %d fallidas)' % (args.summary, lanzadas - fallidas, fallidas))
+    return 1 if fallidas else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())